@@ -19,11 +19,18 @@ assert os.getcwd().split("/")[-1] == "algorithms-sedgewick-wayne", \
 # Number of iterations to average over.
 N = 25
 
-# Data file to sort.
+# Data file to sort. By default a seeded workload is generated so that results
+# are reproducible without the algs4-data files.
 # DATA = "./algs4-data/words3.txt"
-DATA = "./algs4-data/medTale.txt"
+# DATA = "./algs4-data/medTale.txt"
+DATA = "./build/sort-random-10000.txt"
+GENERATE = ["./build/workload-generator", "sort", "random", "10000", "--seed", "2017",
+            "--output", DATA]
 
 def main():
+    if not os.path.isfile(DATA):
+        subprocess.check_call(GENERATE)
+
     sorts = ["selection-sort",
              "insertion-sort",
              "shell-sort"]
@@ -36,10 +43,12 @@ def main():
         accumulated_time = 0
         for i in range(N):
             # Note shell=True has security implications. Don't accept external inputs.
-            b_output = subprocess.check_output(" ".join([exe_path, DATA]), shell=True)
+            # Pass --checksum so that printing the sorted tokens doesn't dominate.
+            b_output = subprocess.check_output(" ".join([exe_path, "--checksum", DATA]), shell=True)
             str_output = str(b_output)
-            # Use regex to extract the number follwing "(ns) =" in the output.
-            accumulated_time += int(re.findall("\d+", str_output)[0])  # Elapsed time in nanoseconds.
+            # Use regex to extract the number follwing "::sort, elapsed time (ns) =" in the output.
+            accumulated_time += int(re.findall("::sort, elapsed time \(ns\) = (\d+)",
+                                               str_output)[0])  # Elapsed time in nanoseconds.
         average_time = accumulated_time / N
 
         if "selection-sort" == sort:
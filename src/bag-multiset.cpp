@@ -8,9 +8,40 @@
 // Items are added one at a time and duplicates are permitted. Items cannot be
 // accessed individually but are emptied all at once (and in an undefined
 // order).
+//
+// A Bag is a natural fit for "many threads add, one thread drains"
+// aggregation, but two threads calling add() at once race on the head
+// pointer. Guarding the head with a lock would make them take turns instead.
+// ConcurrentBag gives each thread its own shard, so add() only ever touches
+// memory that no other thread writes. Each shard is a linked list of chunks
+// holding many items each, so there is one allocation per chunk rather than
+// one per item.
+//
+//   thread 0: [ 1024 items ] -> [ 1024 items ] -> [ 17 items ]
+//   thread 1: [ 1024 items ] -> [ 600 items ]
+//
+// Each bag maps thread ids to their shards, under a lock. A thread also keeps
+// a small thread_local cache of (bag, shard) pairs, indexed by bag id modulo
+// its size, so adds which go back and forth between a handful of bags skip
+// the lock. Entries are overwritten rather than appended, so the cache never
+// grows, however many bags a long-lived thread adds to.
+//
+// Since a bag has no order, draining or iterating just walks the shards one
+// after the other; nothing is copied to merge them. Those operations must not
+// run at the same time as add(), e.g. call them after joining the writers.
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 using std::make_shared;
 using std::shared_ptr;
@@ -27,6 +58,8 @@ public:
 
   string print_contents();
 
+  ~Bag() { empty_bag(); }
+
 private:
   struct Node {
     T value;
@@ -47,7 +80,11 @@ template <typename T> void Bag<T>::add(T item) {
 
 template <typename T> void Bag<T>::empty_bag() {
   N = 0;
-  first = nullptr; // Clear the shared_ptr.
+  // Clear the shared_ptr one node at a time. Simply assigning nullptr would
+  // free the nodes recursively, which overflows the stack for long lists.
+  while (first != nullptr) {
+    first = first->next;
+  }
 }
 
 template <typename T> string Bag<T>::print_contents() {
@@ -70,6 +107,154 @@ template <typename T> string Bag<T>::print_contents() {
   return str;
 }
 
+template <typename T> class ConcurrentBag {
+public:
+  ConcurrentBag() : bag_id(next_bag_id.fetch_add(1)) {}
+
+  ~ConcurrentBag() { empty_bag(); }
+
+  ConcurrentBag(const ConcurrentBag &) = delete;
+  ConcurrentBag &operator=(const ConcurrentBag &) = delete;
+
+  // Safe to call from any number of threads at once.
+  void add(T item);
+
+  // These must not run concurrently with add().
+  bool is_empty() { return (size() == 0); }
+  int size();
+  void empty_bag();
+  template <typename F> void for_each(F visit);
+  string print_contents();
+
+private:
+  static constexpr int chunk_capacity = 1024;
+  struct Chunk {
+    T items[chunk_capacity];
+    int count = 0;
+    std::unique_ptr<Chunk> next = nullptr;
+  };
+
+  // Each shard is only written by the thread which owns it. Aligning them to
+  // cache lines keeps neighbouring shards from false sharing.
+  struct alignas(64) Shard {
+    std::unique_ptr<Chunk> first = nullptr;
+    int N = 0;
+  };
+
+  // Only taken when a thread's cached shard belongs to another bag.
+  std::mutex registry_mutex;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::unordered_map<std::thread::id, Shard *> shard_of_thread;
+
+  // Threads cache (bag_id, shard) pairs. An id is never reused, so a thread
+  // can't mistake a new bag for a destroyed one at the same address. Bags
+  // are numbered consecutively, so up to cache_size bags created together
+  // land in distinct entries.
+  const std::uint64_t bag_id;
+  static inline std::atomic<std::uint64_t> next_bag_id{0};
+  static constexpr std::uint64_t cache_size = 16;
+  struct CacheEntry {
+    std::uint64_t bag_id = UINT64_MAX;
+    Shard *shard = nullptr;
+  };
+
+  Shard &local_shard();
+};
+
+template <typename T>
+typename ConcurrentBag<T>::Shard &ConcurrentBag<T>::local_shard() {
+  thread_local CacheEntry cache[cache_size];
+  CacheEntry &entry = cache[bag_id % cache_size];
+  if (entry.bag_id == bag_id)
+    return *entry.shard;
+
+  // Look up this thread's shard, registering one on its first add(). A thread
+  // id may be reused after a thread exits, which is harmless: the new thread
+  // takes over a shard that nothing else writes to any more.
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  Shard *&shard = shard_of_thread[std::this_thread::get_id()];
+  if (shard == nullptr) {
+    shards.push_back(std::make_unique<Shard>());
+    shard = shards.back().get();
+  }
+  entry = {bag_id, shard};
+  return *shard;
+}
+
+template <typename T> void ConcurrentBag<T>::add(T item) {
+  Shard &shard = local_shard();
+  if (shard.first == nullptr || shard.first->count == chunk_capacity) {
+    auto chunk = std::make_unique<Chunk>();
+    chunk->next = std::move(shard.first);
+    shard.first = std::move(chunk);
+  }
+  shard.first->items[shard.first->count++] = item;
+  shard.N++;
+}
+
+template <typename T> int ConcurrentBag<T>::size() {
+  int N = 0;
+  for (auto &shard : shards) {
+    N += shard->N;
+  }
+  return N;
+}
+
+template <typename T> void ConcurrentBag<T>::empty_bag() {
+  // Keep the shards registered, since threads have cached them.
+  for (auto &shard : shards) {
+    // Unlink chunk by chunk, rather than recursively through unique_ptr.
+    while (shard->first != nullptr) {
+      shard->first = std::move(shard->first->next);
+    }
+    shard->N = 0;
+  }
+}
+
+template <typename T>
+template <typename F>
+void ConcurrentBag<T>::for_each(F visit) {
+  for (auto &shard : shards) {
+    for (Chunk *chunk = shard->first.get(); chunk != nullptr;
+         chunk = chunk->next.get()) {
+      for (int i = 0; i < chunk->count; i++) {
+        visit(chunk->items[i]);
+      }
+    }
+  }
+}
+
+template <typename T> string ConcurrentBag<T>::print_contents() {
+  string str;
+  str.reserve(size() * 5);
+  for_each([&](const T &item) {
+    str += " ";
+    str += std::to_string(item);
+  });
+  return str;
+}
+
+// Add num_items from num_threads threads at once, returning the elapsed time
+// in nanoseconds.
+template <typename Add>
+long long time_parallel_adds(int num_threads, int num_items, Add add) {
+  std::vector<std::thread> threads;
+  auto begin = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([=]() {
+      for (int i = t; i < num_items; i += num_threads) {
+        add(static_cast<double>(i));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+      .count();
+}
+
 int main() {
   using std::cout;
   using std::endl;
@@ -101,4 +286,93 @@ int main() {
        << endl;
   cout << "Request status, the multiset is empty: "
        << (test_multiset.is_empty() ? "true" : "false") << endl;
+
+  // The same operations on a ConcurrentBag, filled from two threads.
+  auto concurrent_multiset = ConcurrentBag<double>{};
+  std::thread writer([&]() {
+    concurrent_multiset.add(1.01);
+    concurrent_multiset.add(2.02);
+  });
+  concurrent_multiset.add(3.14);
+  concurrent_multiset.add(1.01);
+  writer.join();
+  cout << "Concurrent multiset has size: " << concurrent_multiset.size()
+       << ", and contains these items: {"
+       << concurrent_multiset.print_contents() << " }" << endl;
+  concurrent_multiset.empty_bag();
+
+  // Benchmark add() throughput from 1 to 64 threads, against a Bag guarded
+  // by a single lock.
+  const int num_items = 1 << 22;
+  for (int num_threads = 1; num_threads <= 64; num_threads *= 2) {
+    auto locked_bag = Bag<double>{};
+    std::mutex bag_mutex;
+    auto locked_ns = time_parallel_adds(num_threads, num_items, [&](double x) {
+      std::lock_guard<std::mutex> lock(bag_mutex);
+      locked_bag.add(x);
+    });
+
+    auto sharded_bag = ConcurrentBag<double>{};
+    auto sharded_ns = time_parallel_adds(
+        num_threads, num_items, [&](double x) { sharded_bag.add(x); });
+
+    if (locked_bag.size() != num_items || sharded_bag.size() != num_items) {
+      cout << "ERROR: items were lost from a bag." << endl;
+      return EXIT_FAILURE;
+    }
+    auto rate = [&](long long ns) {
+      return ns > 0 ? 1e3 * num_items / static_cast<double>(ns) : 0.0;
+    };
+    cout << num_threads << " threads adding " << num_items
+         << " items, M adds/s: Bag with lock = " << rate(locked_ns)
+         << ", ConcurrentBag = " << rate(sharded_ns) << endl;
+  }
+
+  // A long-lived thread adding to many short-lived bags, which must not slow
+  // down (or leak) as the number of bags it has seen grows.
+  const int num_bags = 1 << 16;
+  const int items_per_bag = 64;
+  for (int round = 1; round <= 2; round++) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int b = 0; b < num_bags; b++) {
+      ConcurrentBag<double> bag;
+      for (int i = 0; i < items_per_bag; i++) {
+        bag.add(static_cast<double>(i));
+      }
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+            .count();
+    cout << "Round " << round << ", " << num_bags << " short-lived bags of "
+         << items_per_bag << " items, M adds/s: ConcurrentBag = "
+         << (ns > 0 ? 1e3 * num_bags * items_per_bag / static_cast<double>(ns)
+                    : 0.0)
+         << endl;
+  }
+
+  // Threads routing their items into several bags at once, which must still
+  // add without taking a lock.
+  const int num_threads = 4;
+  for (int num_bags_used : {1, 2, 4, 8}) {
+    std::vector<std::unique_ptr<ConcurrentBag<double>>> bags;
+    for (int b = 0; b < num_bags_used; b++) {
+      bags.push_back(std::make_unique<ConcurrentBag<double>>());
+    }
+    auto ns = time_parallel_adds(num_threads, num_items, [&](double x) {
+      bags[static_cast<std::size_t>(x) % bags.size()]->add(x);
+    });
+    int total = 0;
+    for (auto &bag : bags) {
+      total += bag->size();
+    }
+    if (total != num_items) {
+      cout << "ERROR: items were lost from a bag." << endl;
+      return EXIT_FAILURE;
+    }
+    cout << num_threads << " threads interleaving " << num_items
+         << " items across " << num_bags_used
+         << " bags, M adds/s: ConcurrentBag = "
+         << (ns > 0 ? 1e3 * num_items / static_cast<double>(ns) : 0.0) << endl;
+  }
 }
@@ -0,0 +1,123 @@
+//
+//  bulk-writer.hpp
+//  Copyright (c) 2017 Dylan Brown. All rights reserved.
+//
+
+// NOTES
+// Writing a million tokens one at a time with `std::cout << item << " "` costs
+// more than sorting them. BulkWriter formats items into one large reusable
+// buffer and hands the whole buffer to fwrite() once it fills up, so the
+// number of calls into the C library is proportional to bytes / capacity
+// rather than the number of items.
+//
+// When constructed without a stream, the writer hashes the formatted bytes
+// with 64-bit FNV-1a instead of writing them. Benchmarks can then confirm the
+// output is unchanged without being I/O bound.
+//
+// Write errors (a full disk, a closed pipe) are remembered rather than
+// reported on every call. Finish with close(), which flushes, closes any
+// stream other than stdout, and returns false if anything was lost.
+
+#ifndef BULK_WRITER_HPP
+#define BULK_WRITER_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+class BulkWriter {
+public:
+  // Pass stream = nullptr to compute a checksum instead of writing.
+  explicit BulkWriter(std::FILE *_stream, std::size_t capacity = 1 << 20)
+      : stream(_stream), buffer(capacity) {}
+
+  ~BulkWriter() { flush(); }
+
+  BulkWriter(const BulkWriter &) = delete;
+  BulkWriter &operator=(const BulkWriter &) = delete;
+
+  void write(char c) {
+    if (used == buffer.size())
+      flush();
+    buffer[used++] = c;
+  }
+
+  void write(std::string_view s) {
+    if (s.size() > buffer.size() - used) {
+      flush();
+      // Items larger than the whole buffer bypass it.
+      if (s.size() > buffer.size()) {
+        consume(s.data(), s.size());
+        return;
+      }
+    }
+    s.copy(buffer.data() + used, s.size());
+    used += s.size();
+  }
+
+  // Format any other item: numbers with std::to_chars, anything else with
+  // operator<< as a fallback.
+  template <typename T> void write(const T &item) {
+    if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+      write(std::string_view(item));
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      char digits[64];
+      auto result = std::to_chars(digits, digits + sizeof(digits), item);
+      write(std::string_view(digits, static_cast<std::size_t>(
+                                         result.ptr - digits)));
+    } else {
+      std::ostringstream formatted;
+      formatted << item;
+      write(std::string_view(formatted.str()));
+    }
+  }
+
+  void flush() {
+    consume(buffer.data(), used);
+    used = 0;
+    if (stream != nullptr && (std::fflush(stream) != 0 || std::ferror(stream)))
+      failed = true;
+  }
+
+  // Flush, then close the stream unless it is stdout. The writer discards
+  // anything written afterwards. Returns false if any write failed.
+  bool close() {
+    flush();
+    if (stream != nullptr && stream != stdout && std::fclose(stream) != 0)
+      failed = true;
+    stream = nullptr;
+    closed = true;
+    return !failed;
+  }
+
+  bool is_hashing() const { return stream == nullptr && !closed; }
+  std::uint64_t checksum() const { return hash; }
+
+private:
+  std::FILE *stream = nullptr;
+  std::vector<char> buffer;
+  std::size_t used = 0;
+  bool failed = false;
+  bool closed = false;
+  std::uint64_t hash = 14695981039346656037ull; // FNV-1a offset basis.
+
+  void consume(const char *data, std::size_t n) {
+    if (n == 0 || closed)
+      return;
+    if (stream != nullptr) {
+      if (std::fwrite(data, 1, n, stream) != n)
+        failed = true;
+      return;
+    }
+    for (std::size_t i = 0; i < n; i++) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 1099511628211ull; // FNV-1a 64-bit prime.
+    }
+  }
+};
+
+#endif // BULK_WRITER_HPP
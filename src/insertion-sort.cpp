@@ -16,9 +16,12 @@
 // compares and swaps) on average (worst case n^2 / 2) to create an ascending
 // sort of comparable items in time O(n^2).
 
+#include "bulk-writer.hpp"
+#include "token-loader.hpp"
+
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -43,11 +46,12 @@ public:
     return true;
   }
 
-  void show(const vector<T> &a) {
-    for (auto item : a) {
-      cout << item << " ";
+  void show(const vector<T> &a, BulkWriter &out) {
+    for (const auto &item : a) {
+      out.write(item);
+      out.write(' ');
     }
-    cout << endl;
+    out.write('\n');
   }
 
 private:
@@ -68,33 +72,58 @@ template <typename T> void Insertion<T>::sort(vector<T> &a) {
 }
 
 int main(int argc, char *argv[]) {
-  // Read file given on command line.
+  // Read file given on command line, along with an optional output mode.
+  // --checksum (or --quiet) replaces the dump with a hash of its contents.
   string filename;
-  if (argc != 2) {
-    cout << "Usage: insertion-sort ../algs4-data/words3.txt" << endl;
+  string output_filename;
+  bool checksum_only = false;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--checksum" || arg == "--quiet") {
+      checksum_only = true;
+    } else if (arg == "--output" && i + 1 < argc) {
+      output_filename = argv[++i];
+    } else if (filename.empty()) {
+      filename = arg;
+    } else {
+      filename.clear(); // Too many arguments.
+      break;
+    }
+  }
+  if (filename.empty()) {
+    cout << "Usage: insertion-sort [--checksum | --output sorted.txt] "
+            "../algs4-data/words3.txt"
+         << endl;
     return EXIT_FAILURE;
-  } else {
-    filename = argv[1];
   }
 
-  std::ifstream input_file(filename);
+  MappedFile input_file(filename);
   if (!input_file.is_open()) {
     cout << "ERROR: failed to open \"" << filename << "\" for reading." << endl;
     return EXIT_FAILURE;
   }
 
+  std::FILE *output_stream = stdout;
+  if (!output_filename.empty() && !checksum_only) {
+    output_stream = std::fopen(output_filename.c_str(), "wb");
+    if (output_stream == nullptr) {
+      cout << "ERROR: failed to open \"" << output_filename
+           << "\" for writing." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   // Instantiate a insertion sort object.
-  auto ins = Insertion<string>();
+  auto ins = Insertion<std::string_view>();
 
   // For this example, we'll sort strings in alphabetical order.
-  // Read the input data into a vector of std::string tokens.
-  vector<string> tokens;
-  for (string tkn; input_file >> tkn;) {
-    tokens.push_back(tkn);
-  }
-  input_file.close();
+  // Tokenize the memory-mapped input in parallel into std::string_view
+  // tokens, which point into the mapped buffer instead of owning copies.
+  auto load_begin = std::chrono::steady_clock::now();
+  auto tokens = tokenize_parallel(input_file.view());
+  auto load_end = std::chrono::steady_clock::now();
 
-  // Apply the weighted quick-union algorithm to the input data.
+  // Apply the sorting algorithm to the input data.
   auto begin = std::chrono::steady_clock::now();
   ins.sort(tokens);
   auto end = std::chrono::steady_clock::now();
@@ -112,5 +141,28 @@ int main(int argc, char *argv[]) {
        << std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
               .count()
        << endl;
-  ins.show(tokens);
+  auto load_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     load_end - load_begin)
+                     .count();
+  cout << "tokenize_parallel, " << tokens.size() << " tokens from "
+       << input_file.view().size()
+       << " bytes, elapsed time (ns) = " << load_ns
+       << ", throughput (GB/s) = "
+       << (load_ns > 0 ? static_cast<double>(input_file.view().size()) /
+                           static_cast<double>(load_ns)
+                     : 0.0)
+       << endl;
+
+  // Format the sorted items into a large buffer which is written in bulk.
+  BulkWriter out(checksum_only ? nullptr : output_stream);
+  ins.show(tokens, out);
+  out.flush();
+  if (out.is_hashing()) {
+    cout << "checksum (FNV-1a 64) = " << std::hex << out.checksum()
+         << std::dec << endl;
+  }
+  if (!out.close()) {
+    cout << "ERROR: failed to write the sorted output." << endl;
+    return EXIT_FAILURE;
+  }
 }
@@ -0,0 +1,435 @@
+//
+//  radix-sort.cpp
+//  Copyright (c) 2017 Dylan Brown. All rights reserved.
+//
+
+// NOTES
+// LSD (least significant digit first) radix sort never compares two keys.
+// It makes one stable counting-sort pass per 8-bit digit, starting with the
+// lowest, so a 32-bit key takes 4 passes and a 64-bit key 8, each O(n). For
+// integer and floating-point keys that beats any O(n lg n) comparison sort
+// once n is large.
+//
+// Radix sort orders unsigned bit patterns, so keys are first transformed:
+//   unsigned integers   unchanged.
+//   signed integers     flip the sign bit, so negatives sort first.
+//   floating point      flip the sign bit of positives, and every bit of
+//                       negatives (larger magnitude = smaller value).
+//
+// Each pass runs in parallel. The array is split into one block per thread,
+// and each thread counts the digits in its block. A prefix sum over (digit,
+// thread) gives every thread its own output range for each digit, so the
+// threads scatter without synchronizing, and the sort stays stable:
+//
+//   digit:        0        1        2    ...
+//   output: [ t0 | t1 ][ t0 | t1 ][ t0 | t1 ] ...
+//
+// Scattering to 256 destinations at once thrashes the cache and the TLB.
+// Each thread stages keys in a small write-combining buffer per digit, and
+// copies a whole buffer (one cache line) to its destination when it fills up.
+// Passes in which every key has the same digit are skipped.
+
+#include "bulk-writer.hpp"
+#include "token-loader.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T> class LSDRadix {
+  static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 4 || sizeof(T) == 8),
+                "LSDRadix sorts 32 and 64-bit integer or floating-point keys.");
+
+public:
+  // Pass _num_threads = 0 to use one thread per hardware thread.
+  LSDRadix(unsigned _num_threads = 0)
+      : num_threads(std::max(
+            1u, _num_threads > 0 ? _num_threads
+                                 : std::thread::hardware_concurrency())) {}
+
+  void sort(std::vector<T> &a);
+
+  bool is_sorted(const std::vector<T> &a) {
+    for (std::size_t i = 1; i < a.size(); i++) {
+      if (less(a[i], a[i - 1])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void show(const std::vector<T> &a, BulkWriter &out) {
+    for (const auto &item : a) {
+      out.write(item);
+      out.write(' ');
+    }
+    out.write('\n');
+  }
+
+private:
+  using Key = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+  static constexpr int radix_bits = 8;
+  static constexpr std::size_t radix = 1 << radix_bits;
+  static constexpr Key sign_bit = Key{1} << (8 * sizeof(Key) - 1);
+  // Keys per write-combining buffer, one 64-byte cache line.
+  static constexpr std::size_t buffer_keys = 64 / sizeof(Key);
+
+  unsigned num_threads;
+
+  // Returns true if v < w. Again, T must implement comparison operators.
+  bool less(T v, T w) { return (v < w); }
+
+  static Key to_key(T item) {
+    Key bits;
+    std::memcpy(&bits, &item, sizeof(bits));
+    if constexpr (std::is_floating_point_v<T>) {
+      return (bits & sign_bit) ? ~bits : (bits | sign_bit);
+    } else if constexpr (std::is_signed_v<T>) {
+      return bits ^ sign_bit;
+    } else {
+      return bits;
+    }
+  }
+
+  static T from_key(Key bits) {
+    if constexpr (std::is_floating_point_v<T>) {
+      bits = (bits & sign_bit) ? (bits & ~sign_bit) : ~bits;
+    } else if constexpr (std::is_signed_v<T>) {
+      bits ^= sign_bit;
+    }
+    T item;
+    std::memcpy(&item, &bits, sizeof(item));
+    return item;
+  }
+
+  // Run body(t, begin, end) on each thread's block of [0, n).
+  template <typename F> void parallel_blocks(std::size_t n, F body) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < num_threads; t++) {
+      workers.emplace_back([&, t]() {
+        body(t, n * t / num_threads, n * (t + 1) / num_threads);
+      });
+    }
+    body(0u, std::size_t{0}, n / num_threads);
+    for (auto &w : workers)
+      w.join();
+  }
+
+  void pass(const std::vector<Key> &src, std::vector<Key> &dst, int shift,
+            std::vector<std::vector<std::size_t>> &offsets);
+};
+
+template <typename T>
+void LSDRadix<T>::pass(const std::vector<Key> &src, std::vector<Key> &dst,
+                       int shift,
+                       std::vector<std::vector<std::size_t>> &offsets) {
+  // offsets[t][d] is where thread t writes its next key with digit d.
+  parallel_blocks(src.size(), [&](unsigned t, std::size_t begin,
+                                  std::size_t end) {
+    std::vector<Key> buffers(radix * buffer_keys);
+    std::vector<std::size_t> fill(radix, 0);
+    auto &next = offsets[t];
+
+    for (std::size_t i = begin; i < end; i++) {
+      Key key = src[i];
+      auto d = static_cast<std::size_t>((key >> shift) & (radix - 1));
+      buffers[d * buffer_keys + fill[d]] = key;
+      if (++fill[d] == buffer_keys) {
+        std::memcpy(dst.data() + next[d], &buffers[d * buffer_keys],
+                    sizeof(Key) * buffer_keys);
+        next[d] += buffer_keys;
+        fill[d] = 0;
+      }
+    }
+    for (std::size_t d = 0; d < radix; d++) {
+      std::memcpy(dst.data() + next[d], &buffers[d * buffer_keys],
+                  sizeof(Key) * fill[d]);
+      next[d] += fill[d];
+    }
+  });
+}
+
+template <typename T> void LSDRadix<T>::sort(std::vector<T> &a) {
+  const std::size_t N = a.size();
+  std::vector<Key> keys(N);
+  std::vector<Key> scratch(N);
+  parallel_blocks(N, [&](unsigned, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      keys[i] = to_key(a[i]);
+  });
+
+  std::vector<std::vector<std::size_t>> counts(
+      num_threads, std::vector<std::size_t>(radix, 0));
+  for (int shift = 0; shift < static_cast<int>(8 * sizeof(Key));
+       shift += radix_bits) {
+    // Count each thread's digits.
+    parallel_blocks(N, [&](unsigned t, std::size_t begin, std::size_t end) {
+      auto &count = counts[t];
+      std::fill(count.begin(), count.end(), 0);
+      for (std::size_t i = begin; i < end; i++)
+        count[(keys[i] >> shift) & (radix - 1)]++;
+    });
+
+    // Prefix sum in (digit, thread) order, turning counts into offsets.
+    // If one digit accounts for every key, this pass wouldn't move anything.
+    bool trivial = false;
+    std::size_t total = 0;
+    for (std::size_t d = 0; d < radix; d++) {
+      std::size_t digit_total = 0;
+      for (unsigned t = 0; t < num_threads; t++) {
+        std::size_t count = counts[t][d];
+        counts[t][d] = total;
+        total += count;
+        digit_total += count;
+      }
+      trivial |= (digit_total == N);
+    }
+    if (trivial)
+      continue;
+
+    pass(keys, scratch, shift, counts);
+    keys.swap(scratch);
+  }
+
+  parallel_blocks(N, [&](unsigned, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++)
+      a[i] = from_key(keys[i]);
+  });
+}
+
+// Shell sort, as in shell-sort.cpp, for comparison.
+template <typename T> class Shell {
+public:
+  // requires Sortable<T> (T must implement comparison operators).
+  void sort(std::vector<T> &a);
+
+private:
+  // Returns true if v < w. Again, T must implement comparison operators.
+  bool less(T v, T w) { return (v < w); }
+  // Pass by reference to ensure std::swap mutates the caller's data.
+  void exch(std::vector<T> &a, long j, long k) { std::swap(a[j], a[k]); }
+};
+
+template <typename T> void Shell<T>::sort(std::vector<T> &a) {
+  long N = static_cast<long>(a.size());
+  long h = 1;
+  while (h < N / 3) // Note the integer division.
+    h = 3 * h + 1;  // 1, 4, 13, 40, 121, 364, 1093, ...
+
+  while (h >= 1) {
+    for (long i = h; i < N; i++) {
+      for (long j = i; j >= h && less(a[j], a[j - h]); j -= h)
+        exch(a, j, j - h);
+    }
+
+    h = h / 3; // Again, note the integer division.
+  }
+}
+
+struct Options {
+  std::string filename;
+  std::string output_filename;
+  std::uint64_t random_keys = 0;
+  unsigned num_threads = 0;
+  bool checksum_only = false;
+  bool compare = false;
+};
+
+template <typename T> long long elapsed_ns(T begin, T end) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+      .count();
+}
+
+template <typename T> int run(const Options &options) {
+  using std::cout;
+  using std::endl;
+
+  // Read the keys from the file, or generate random ones.
+  std::vector<T> keys;
+  if (options.random_keys > 0) {
+    std::mt19937_64 rng(2017);
+    keys.resize(options.random_keys);
+    for (auto &key : keys) {
+      std::uint64_t bits = rng();
+      if constexpr (std::is_floating_point_v<T>) {
+        // Uniform on [-1e9, 1e9).
+        key = static_cast<T>((static_cast<double>(bits >> 11) /
+                                  9007199254740992.0 * 2.0 -
+                              1.0) *
+                             1e9);
+      } else {
+        key = static_cast<T>(bits);
+      }
+    }
+  } else {
+    MappedFile input_file(options.filename);
+    if (!input_file.is_open()) {
+      cout << "ERROR: failed to open \"" << options.filename
+           << "\" for reading." << endl;
+      return EXIT_FAILURE;
+    }
+    auto tokens = tokenize_parallel(input_file.view());
+    keys.resize(tokens.size());
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+      auto result = std::from_chars(
+          tokens[i].data(), tokens[i].data() + tokens[i].size(), keys[i]);
+      if (result.ec != std::errc() ||
+          result.ptr != tokens[i].data() + tokens[i].size()) {
+        cout << "ERROR: \"" << tokens[i] << "\" is not a valid key." << endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  std::FILE *output_stream = stdout;
+  if (!options.output_filename.empty() && !options.checksum_only) {
+    output_stream = std::fopen(options.output_filename.c_str(), "wb");
+    if (output_stream == nullptr) {
+      cout << "ERROR: failed to open \"" << options.output_filename
+           << "\" for writing." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Copies for the comparison sorts, taken before sorting.
+  std::vector<T> std_keys;
+  std::vector<T> shell_keys;
+  if (options.compare) {
+    std_keys = keys;
+    if (keys.size() <= 10000000) // Shell sort is too slow beyond this.
+      shell_keys = keys;
+  }
+
+  // Instantiate a radix sort object.
+  auto rdx = LSDRadix<T>(options.num_threads);
+
+  // Apply the sorting algorithm to the input data.
+  auto begin = std::chrono::steady_clock::now();
+  rdx.sort(keys);
+  auto end = std::chrono::steady_clock::now();
+
+  // Ensure that the data structure is sorted.
+  if (!rdx.is_sorted(keys)) {
+    cout << "ERROR: upon review, radix sort failed to completely sort the data."
+         << endl;
+    return EXIT_FAILURE;
+  }
+
+  // Output the performance and results.
+  cout << "LSDRadix::sort, " << keys.size() << " keys, elapsed time (ns) = "
+       << elapsed_ns(begin, end) << endl;
+
+  if (options.compare) {
+    begin = std::chrono::steady_clock::now();
+    std::sort(std_keys.begin(), std_keys.end());
+    end = std::chrono::steady_clock::now();
+    cout << "std::sort, elapsed time (ns) = " << elapsed_ns(begin, end)
+         << endl;
+
+    if (!shell_keys.empty()) {
+      auto shl = Shell<T>();
+      begin = std::chrono::steady_clock::now();
+      shl.sort(shell_keys);
+      end = std::chrono::steady_clock::now();
+      cout << "Shell::sort, elapsed time (ns) = " << elapsed_ns(begin, end)
+           << endl;
+    }
+
+    // Both should agree, treating -0.0 and 0.0 as equal (radix sort puts
+    // -0.0 first, std::sort leaves them in any order).
+    auto same = [](T x, T y) { return !(x < y) && !(y < x); };
+    if (!std::equal(keys.begin(), keys.end(), std_keys.begin(), same)) {
+      cout << "ERROR: LSDRadix and std::sort disagree." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Format the sorted items into a large buffer which is written in bulk.
+  BulkWriter out(options.checksum_only ? nullptr : output_stream);
+  rdx.show(keys, out);
+  out.flush();
+  if (out.is_hashing()) {
+    cout << "checksum (FNV-1a 64) = " << std::hex << out.checksum()
+         << std::dec << endl;
+  }
+  if (!out.close()) {
+    cout << "ERROR: failed to write the sorted output." << endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+  using std::cout;
+  using std::endl;
+
+  // Read the key type and file given on command line, or a number of random
+  // keys to generate instead.
+  Options options;
+  std::string type = "i32";
+  bool bad_arguments = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--type" && i + 1 < argc) {
+      type = argv[++i];
+    } else if (arg == "--random" && i + 1 < argc) {
+      char *end = nullptr;
+      options.random_keys = std::strtoull(argv[++i], &end, 10);
+      bad_arguments |= (*end != '\0' || argv[i][0] == '-');
+    } else if (arg == "--threads" && i + 1 < argc) {
+      // Reject anything but 1 to 4096 threads, e.g. -1 would wrap around.
+      char *end = nullptr;
+      long num_threads = std::strtol(argv[++i], &end, 10);
+      bad_arguments |= (*end != '\0' || num_threads < 1 || num_threads > 4096);
+      options.num_threads = static_cast<unsigned>(
+          std::clamp(num_threads, 1l, 4096l));
+    } else if (arg == "--compare") {
+      options.compare = true;
+    } else if (arg == "--checksum" || arg == "--quiet") {
+      options.checksum_only = true;
+    } else if (arg == "--output" && i + 1 < argc) {
+      options.output_filename = argv[++i];
+    } else if (options.filename.empty()) {
+      options.filename = arg;
+    } else {
+      bad_arguments = true;
+    }
+  }
+  if (bad_arguments ||
+      (options.filename.empty() == (options.random_keys == 0))) {
+    cout << "Usage: radix-sort [--type u32|i32|u64|i64|f32|f64] "
+            "[--threads N] [--compare]"
+         << endl
+         << "                  [--checksum | --output sorted.txt] "
+            "{keys.txt | --random N}"
+         << endl;
+    return EXIT_FAILURE;
+  }
+
+  if (type == "u32")
+    return run<std::uint32_t>(options);
+  if (type == "i32")
+    return run<std::int32_t>(options);
+  if (type == "u64")
+    return run<std::uint64_t>(options);
+  if (type == "i64")
+    return run<std::int64_t>(options);
+  if (type == "f32")
+    return run<float>(options);
+  if (type == "f64")
+    return run<double>(options);
+
+  cout << "ERROR: unknown key type \"" << type << "\"." << endl;
+  return EXIT_FAILURE;
+}
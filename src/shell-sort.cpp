@@ -23,9 +23,12 @@
 // ->V. Pratt (1971): (3^k - 1) / 2, and < ceil(N/3) ... 1.  // O(n^(3/2))
 //   M. Ciura (2001): 1750, 701, 301, 132, 57, 23, 10, 4, 1. // Empirical proof
 
+#include "bulk-writer.hpp"
+#include "token-loader.hpp"
+
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -45,11 +48,12 @@ public:
     return true;
   }
 
-  void show(const std::vector<T> &a) {
-    for (auto item : a) {
-      std::cout << item << " ";
+  void show(const std::vector<T> &a, BulkWriter &out) {
+    for (const auto &item : a) {
+      out.write(item);
+      out.write(' ');
     }
-    std::cout << std::endl;
+    out.write('\n');
   }
 
 private:
@@ -76,34 +80,59 @@ template <typename T> void Shell<T>::sort(std::vector<T> &a) {
 }
 
 int main(int argc, char *argv[]) {
-  // Read file given on command line.
+  // Read file given on command line, along with an optional output mode.
+  // --checksum (or --quiet) replaces the dump with a hash of its contents.
   std::string filename;
-  if (argc != 2) {
-    std::cout << "Usage: shell-sort ../algs4-data/words3.txt" << std::endl;
+  std::string output_filename;
+  bool checksum_only = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--checksum" || arg == "--quiet") {
+      checksum_only = true;
+    } else if (arg == "--output" && i + 1 < argc) {
+      output_filename = argv[++i];
+    } else if (filename.empty()) {
+      filename = arg;
+    } else {
+      filename.clear(); // Too many arguments.
+      break;
+    }
+  }
+  if (filename.empty()) {
+    std::cout << "Usage: shell-sort [--checksum | --output sorted.txt] "
+                 "../algs4-data/words3.txt"
+              << std::endl;
     return EXIT_FAILURE;
-  } else {
-    filename = argv[1];
   }
 
-  std::ifstream input_file(filename);
+  MappedFile input_file(filename);
   if (!input_file.is_open()) {
     std::cout << "ERROR: failed to open \"" << filename << "\" for reading."
               << std::endl;
     return EXIT_FAILURE;
   }
 
+  std::FILE *output_stream = stdout;
+  if (!output_filename.empty() && !checksum_only) {
+    output_stream = std::fopen(output_filename.c_str(), "wb");
+    if (output_stream == nullptr) {
+      std::cout << "ERROR: failed to open \"" << output_filename
+                << "\" for writing." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   // Instantiate a shell sort object.
-  auto shl = Shell<std::string>();
+  auto shl = Shell<std::string_view>();
 
   // For this example, we'll sort strings in alphabetical order.
-  // Read the input data into a std::vector of std::string tokens.
-  std::vector<std::string> tokens;
-  for (std::string tkn; input_file >> tkn;) {
-    tokens.push_back(tkn);
-  }
-  input_file.close();
+  // Tokenize the memory-mapped input in parallel into std::string_view
+  // tokens, which point into the mapped buffer instead of owning copies.
+  auto load_begin = std::chrono::steady_clock::now();
+  auto tokens = tokenize_parallel(input_file.view());
+  auto load_end = std::chrono::steady_clock::now();
 
-  // Apply the weighted quick-union algorithm to the input data.
+  // Apply the sorting algorithm to the input data.
   auto begin = std::chrono::steady_clock::now();
   shl.sort(tokens);
   auto end = std::chrono::steady_clock::now();
@@ -121,5 +150,28 @@ int main(int argc, char *argv[]) {
             << std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
                    .count()
             << std::endl;
-  shl.show(tokens);
+  auto load_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     load_end - load_begin)
+                     .count();
+  std::cout << "tokenize_parallel, " << tokens.size() << " tokens from "
+            << input_file.view().size()
+            << " bytes, elapsed time (ns) = " << load_ns
+            << ", throughput (GB/s) = "
+            << (load_ns > 0 ? static_cast<double>(input_file.view().size()) /
+                                static_cast<double>(load_ns)
+                          : 0.0)
+            << std::endl;
+
+  // Format the sorted items into a large buffer which is written in bulk.
+  BulkWriter out(checksum_only ? nullptr : output_stream);
+  shl.show(tokens, out);
+  out.flush();
+  if (out.is_hashing()) {
+    std::cout << "checksum (FNV-1a 64) = " << std::hex << out.checksum()
+              << std::dec << std::endl;
+  }
+  if (!out.close()) {
+    std::cout << "ERROR: failed to write the sorted output." << std::endl;
+    return EXIT_FAILURE;
+  }
 }
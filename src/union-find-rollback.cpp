@@ -0,0 +1,353 @@
+//
+//  union-find-rollback.cpp
+//  Copyright (c) 2017 Dylan Brown. All rights reserved.
+//
+
+// NOTES
+// WeightedQuickUnionUF (see union-find.cpp) can only ever merge components, so
+// asking "what if this edge weren't there?" means rebuilding from scratch.
+// RollbackUF records every union on an undo log instead. snapshot() returns a
+// checkpoint, the current length of the log, and rollback_to() pops unions off
+// the log until it is that length again. Each union changes exactly two
+// entries (the old root's parent and the new root's size), so undoing one is
+// O(1). Path compression would rewrite arbitrary entries during find(), so it
+// is left out; union by size alone keeps the trees O(lg n) deep.
+//
+// That is enough for offline dynamic connectivity, where edges are deleted as
+// well as added but all of the operations are known in advance. Each edge is
+// alive for an interval of the query timeline. The intervals are stored in a
+// segment tree over time, so that each one lands in O(lg q) nodes:
+//
+//   time:      q0  q1  q2  q3        An edge alive from q1 to q3 is stored
+//            [      0 .. 3     ]     in node [1] and node [2..3].
+//            [ 0..1 ]  [ 2..3  ]
+//            [0] [1]   [2] [3]
+//
+// A depth-first walk of the tree applies each node's edges on the way down and
+// rolls them back on the way up, answering each query at its leaf. The total
+// cost is O((e lg q + q) lg n) rather than a full rebuild for every query.
+//
+// The input is the number of vertices on the first line, then one operation
+// per line:
+//   + p q    add the edge p-q.
+//   - p q    remove the edge p-q.
+//   ? p q    are p and q connected?
+//   #        how many connected components are there?
+
+#include "bulk-writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::pair;
+using std::vector;
+
+class RollbackUF {
+public:
+  RollbackUF(int num_vertices) : id(num_vertices), sz(num_vertices, 1) {
+    // Initialize with reflexive property, each vertex connected to itself.
+    count = num_vertices;
+    std::iota(id.begin(), id.end(), 0);
+  }
+
+  bool connected(int p, int q) { return find(p) == find(q); }
+  int count_connected_components() { return count; }
+
+  int find(int);
+  bool union_edge(int, int);
+
+  // A checkpoint is simply the length of the undo log.
+  int snapshot() { return static_cast<int>(history.size()); }
+  void rollback_to(int checkpoint);
+
+private:
+  vector<int> id;
+  vector<int> sz;
+  int count;
+  // Each entry is the root which was linked beneath another root.
+  vector<int> history;
+};
+
+int RollbackUF::find(int p) {
+  // Follow links to find the tree's root. No path compression, so that
+  // every union can be undone.
+  while (p != id[p]) {
+    p = id[p];
+  }
+  return p;
+}
+
+bool RollbackUF::union_edge(int p, int q) {
+  int i = find(p);
+  int j = find(q);
+  if (i == j)
+    return false; // Nothing to record if vertices already share a root.
+
+  // Make the smaller tree's root point upstream to the larger tree.
+  if (sz[i] > sz[j])
+    std::swap(i, j);
+  id[i] = j;
+  sz[j] += sz[i];
+  count--;
+  history.push_back(i);
+  return true;
+}
+
+void RollbackUF::rollback_to(int checkpoint) {
+  while (snapshot() > checkpoint) {
+    int i = history.back();
+    history.pop_back();
+    int j = id[i];
+    sz[j] -= sz[i];
+    id[i] = i;
+    count++;
+  }
+}
+
+struct Operation {
+  char type; // One of '+', '-', '?' or '#'.
+  int p;
+  int q;
+};
+
+class OfflineDynamicConnectivity {
+public:
+  OfflineDynamicConnectivity(int num_vertices) : uf(num_vertices) {}
+
+  // Returns one answer per query: 1 or 0 for '?', the count for '#'.
+  vector<int> answer(const vector<Operation> &operations);
+
+private:
+  RollbackUF uf;
+  vector<vector<pair<int, int>>> tree; // Edges stored at each node.
+  vector<Operation> queries;
+  vector<int> answers;
+
+  void insert(int node, int lo, int hi, int begin, int end,
+              pair<int, int> edge);
+  void solve(int node, int lo, int hi);
+};
+
+vector<int>
+OfflineDynamicConnectivity::answer(const vector<Operation> &operations) {
+  // Number the queries, and find the interval of queries for which each
+  // edge is alive. Duplicate edges are allowed, so keep a stack of start
+  // times for each one.
+  std::map<pair<int, int>, vector<int>> alive;
+  vector<pair<pair<int, int>, pair<int, int>>> intervals;
+  queries.clear();
+  for (const auto &op : operations) {
+    auto edge = std::make_pair(std::min(op.p, op.q), std::max(op.p, op.q));
+    int now = static_cast<int>(queries.size());
+    if (op.type == '+') {
+      alive[edge].push_back(now);
+    } else if (op.type == '-') {
+      auto it = alive.find(edge);
+      if (it == alive.end() || it->second.empty())
+        continue; // Removing an edge which isn't there does nothing.
+      intervals.push_back({edge, {it->second.back(), now}});
+      it->second.pop_back();
+    } else {
+      queries.push_back(op);
+    }
+  }
+  int num_queries = static_cast<int>(queries.size());
+  for (const auto &entry : alive) {
+    for (int start : entry.second) {
+      intervals.push_back({entry.first, {start, num_queries}});
+    }
+  }
+
+  answers.assign(queries.size(), 0);
+  if (num_queries == 0)
+    return answers;
+
+  tree.assign(4 * queries.size(), {});
+  for (const auto &interval : intervals) {
+    int begin = interval.second.first;
+    int end = interval.second.second;
+    if (begin < end)
+      insert(1, 0, num_queries, begin, end, interval.first);
+  }
+  solve(1, 0, num_queries);
+  return answers;
+}
+
+// Store the edge in the nodes covering [begin, end) of node's range [lo, hi).
+void OfflineDynamicConnectivity::insert(int node, int lo, int hi, int begin,
+                                        int end, pair<int, int> edge) {
+  if (end <= lo || hi <= begin)
+    return;
+  if (begin <= lo && hi <= end) {
+    tree[node].push_back(edge);
+    return;
+  }
+  int mid = lo + (hi - lo) / 2;
+  insert(2 * node, lo, mid, begin, end, edge);
+  insert(2 * node + 1, mid, hi, begin, end, edge);
+}
+
+void OfflineDynamicConnectivity::solve(int node, int lo, int hi) {
+  int checkpoint = uf.snapshot();
+  for (const auto &edge : tree[node]) {
+    uf.union_edge(edge.first, edge.second);
+  }
+
+  if (hi - lo == 1) {
+    const auto &query = queries[lo];
+    answers[lo] = (query.type == '?') ? uf.connected(query.p, query.q)
+                                      : uf.count_connected_components();
+  } else {
+    int mid = lo + (hi - lo) / 2;
+    solve(2 * node, lo, mid);
+    solve(2 * node + 1, mid, hi);
+  }
+
+  uf.rollback_to(checkpoint);
+}
+
+// The alternative: rebuild the structure from the live edges at every query.
+vector<int> rebuild_per_query(int num_vertices,
+                              const vector<Operation> &operations) {
+  std::map<pair<int, int>, int> alive; // Edge multiplicities.
+  vector<int> answers;
+  for (const auto &op : operations) {
+    auto edge = std::make_pair(std::min(op.p, op.q), std::max(op.p, op.q));
+    if (op.type == '+') {
+      alive[edge]++;
+    } else if (op.type == '-') {
+      auto it = alive.find(edge);
+      if (it != alive.end() && --it->second == 0)
+        alive.erase(it);
+    } else {
+      RollbackUF uf(num_vertices);
+      for (const auto &entry : alive) {
+        uf.union_edge(entry.first.first, entry.first.second);
+      }
+      answers.push_back((op.type == '?') ? uf.connected(op.p, op.q)
+                                         : uf.count_connected_components());
+    }
+  }
+  return answers;
+}
+
+int main(int argc, char *argv[]) {
+  using std::cout;
+  using std::endl;
+
+  // Read file given on command line.
+  std::string filename;
+  bool compare_rebuild = false;
+  bool checksum_only = false;
+  bool bad_arguments = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--compare-rebuild") {
+      compare_rebuild = true;
+    } else if (arg == "--checksum") {
+      checksum_only = true;
+    } else if (arg.rfind("--", 0) == 0 || !filename.empty()) {
+      bad_arguments = true; // An unknown option, or a second filename.
+    } else {
+      filename = arg;
+    }
+  }
+  if (bad_arguments || filename.empty()) {
+    cout << "Usage: union-find-rollback [--compare-rebuild] [--checksum] "
+            "dynamicUF.txt"
+         << endl;
+    return EXIT_FAILURE;
+  }
+
+  // A filename of "-" reads standard input, e.g. from workload-generator.
+  std::ifstream input_file;
+  if (filename != "-") {
+    input_file.open(filename);
+    if (!input_file.is_open()) {
+      cout << "ERROR: failed to open \"" << filename << "\" for reading."
+           << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::istream &input = (filename == "-") ? std::cin : input_file;
+
+  int num_vertices = 0;
+  if (!(input >> num_vertices) || num_vertices < 0) {
+    cout << "ERROR: expected the number of vertices on the first line."
+         << endl;
+    return EXIT_FAILURE;
+  }
+
+  vector<Operation> operations;
+  for (char type; input >> type;) {
+    Operation op{type, 0, 0};
+    if (type != '#' && !(input >> op.p >> op.q)) {
+      cout << "ERROR: invalid operands for operation \"" << type << "\"."
+           << endl;
+      return EXIT_FAILURE;
+    }
+    bool valid = (type == '+' || type == '-' || type == '?' || type == '#') &&
+                 op.p >= 0 && op.p < num_vertices && op.q >= 0 &&
+                 op.q < num_vertices;
+    if (!valid) {
+      cout << "ERROR: invalid operation \"" << type << " " << op.p << " "
+           << op.q << "\"." << endl;
+      return EXIT_FAILURE;
+    }
+    operations.push_back(op);
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  auto dynamic_connectivity = OfflineDynamicConnectivity(num_vertices);
+  auto answers = dynamic_connectivity.answer(operations);
+  auto end = std::chrono::steady_clock::now();
+
+  // Print one answer per query, or just a hash of them.
+  {
+    BulkWriter out(checksum_only ? nullptr : stdout);
+    for (std::size_t i = 0; i < answers.size(); i++) {
+      out.write(answers[i]);
+      out.write('\n');
+    }
+    out.flush();
+    if (out.is_hashing()) {
+      cout << "checksum (FNV-1a 64) = " << std::hex << out.checksum()
+           << std::dec << endl;
+    }
+    if (!out.close()) {
+      cout << "ERROR: failed to write the answers." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  cout << operations.size() << " operations, " << answers.size()
+       << " queries." << endl
+       << "OfflineDynamicConnectivity::answer, elapsed time (ns) = "
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+              .count()
+       << endl;
+
+  if (compare_rebuild) {
+    auto rebuild_begin = std::chrono::steady_clock::now();
+    auto rebuilt_answers = rebuild_per_query(num_vertices, operations);
+    auto rebuild_end = std::chrono::steady_clock::now();
+    cout << "Rebuild per query, elapsed time (ns) = "
+         << std::chrono::duration_cast<std::chrono::nanoseconds>(rebuild_end -
+                                                                  rebuild_begin)
+                .count()
+         << endl;
+    if (rebuilt_answers != answers) {
+      cout << "ERROR: rebuilding per query gave different answers." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+}
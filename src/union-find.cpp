@@ -10,50 +10,115 @@
 // the total number of distinct connected components in the union-find data
 // structure. The implementation here is 'weighted quick-union' or the
 // union-by-rank algorithm, with performance O(lg n).
+//
+// Rebuilding the structure means replaying every edge. Instead, the id/sz
+// arrays and component count can be saved to a snapshot file:
+//   [ header (32 bytes) | id[0..n) | sz[0..n) ]
+// Loading maps the file with mmap() as a private copy-on-write mapping, so
+// startup costs only page faults on the entries which are actually touched.
+// Further edges may then be applied on top of the loaded state without
+// modifying the file on disk. The header, the file size and the component
+// count are validated on load, but the id/sz entries are trusted: checking
+// them would mean reading every page, so only load snapshots this program
+// wrote.
+//
+// With --sparse, vertices are arbitrary 64-bit IDs (e.g. hashes) rather than
+// dense ints declared up front. SparseIdMap assigns each ID a dense index the
+// first time it's seen, and the structure grows one vertex at a time using
+// 64-bit indices.
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using std::pair;
 using std::vector;
 
-class WeightedQuickUnionUF {
+template <typename Index = int> class WeightedQuickUnionUF {
 public:
-  WeightedQuickUnionUF(int num_vertices) {
+  WeightedQuickUnionUF(Index num_vertices)
+      : id_storage(static_cast<std::size_t>(num_vertices)),
+        sz_storage(static_cast<std::size_t>(num_vertices), 1) {
     // Constructor creates a vector with each index representing the vertex
     // and the value representing the root of that connected component.
     count = num_vertices;
-    id.reserve(num_vertices);
-    sz.reserve(num_vertices);
-
-    for (int i = 0; i < num_vertices; i++) {
-      id[i] = i; // Initialize with reflexive property, each vertex
-                 // connected to itself.
-    }
+    n = num_vertices;
 
-    for (int i = 0; i < num_vertices; i++) {
-      sz[i] = 1; // Keep track of each tree's size for balance.
-    }
+    // Initialize with reflexive property, each vertex connected to itself.
+    // Keep track of each tree's size for balance.
+    std::iota(id_storage.begin(), id_storage.end(), Index{0});
+    id = id_storage.data();
+    sz = sz_storage.data();
   }
 
-  bool connected(int p, int q) { return find(p) == find(q); }
+  ~WeightedQuickUnionUF() { unmap(); }
+
+  // Holds raw pointers into its own storage or a mapping, so forbid copies.
+  WeightedQuickUnionUF(const WeightedQuickUnionUF &) = delete;
+  WeightedQuickUnionUF &operator=(const WeightedQuickUnionUF &) = delete;
+
+  bool connected(Index p, Index q) { return find(p) == find(q); }
+  Index size() { return n; }
 
-  int find(int);
-  void union_edge(int, int);
-  int count_connected_components(vector<pair<int, int>>);
+  Index find(Index);
+  void union_edge(Index, Index);
+  Index count_connected_components(const vector<pair<Index, Index>> &);
+  Index add_vertex();
+
+  bool save_snapshot(const std::string &filename);
+  bool load_snapshot(const std::string &filename);
 
 private:
-  vector<int> id;
-  vector<int> sz;
-  int count;
+  vector<Index> id_storage;
+  vector<Index> sz_storage;
+  // Point into either the vectors above or a mapped snapshot.
+  Index *id = nullptr;
+  Index *sz = nullptr;
+  Index count;
+  Index n;
+
+  void *mapping = nullptr;
+  std::size_t mapping_length = 0;
+
+  void unmap() {
+    if (mapping != nullptr)
+      ::munmap(mapping, mapping_length);
+    mapping = nullptr;
+  }
+
+  // Native byte order. The index width is recorded so that a snapshot is
+  // never reinterpreted with a different index type.
+  struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t index_bytes;
+    std::uint64_t num_vertices;
+    std::uint64_t count;
+  };
+  static constexpr char snapshot_magic[8] = {'W', 'Q', 'U', 'F', 'S',
+                                             'N', 'A', 'P'};
 };
 
-int WeightedQuickUnionUF::find(int p) {
+template <typename Index> Index WeightedQuickUnionUF<Index>::find(Index p) {
   // Follow links recursively to find the tree's root.
   while (p != id[p]) {
     p = id[p];
@@ -61,9 +126,10 @@ int WeightedQuickUnionUF::find(int p) {
   return p;
 }
 
-void WeightedQuickUnionUF::union_edge(int p, int q) {
-  int i = find(p);
-  int j = find(q);
+template <typename Index>
+void WeightedQuickUnionUF<Index>::union_edge(Index p, Index q) {
+  Index i = find(p);
+  Index j = find(q);
   if (i == j)
     return; // Return early if vertices already share a root.
 
@@ -78,8 +144,9 @@ void WeightedQuickUnionUF::union_edge(int p, int q) {
   count--; // One less connected component.
 }
 
-int WeightedQuickUnionUF::count_connected_components(
-    vector<pair<int, int>> graph_connectivity) {
+template <typename Index>
+Index WeightedQuickUnionUF<Index>::count_connected_components(
+    const vector<pair<Index, Index>> &graph_connectivity) {
   for (auto edge : graph_connectivity) {
     auto p = std::get<0>(edge); // Unpack the pair.
     auto q = std::get<1>(edge);
@@ -95,50 +162,508 @@ int WeightedQuickUnionUF::count_connected_components(
   return count;
 }
 
+template <typename Index> Index WeightedQuickUnionUF<Index>::add_vertex() {
+  // A mapped snapshot can't grow in place, so copy it into the vectors.
+  if (mapping != nullptr) {
+    id_storage.assign(id, id + n);
+    sz_storage.assign(sz, sz + n);
+    unmap();
+  }
+  // Amortized O(1), the vectors double their capacity as needed.
+  id_storage.push_back(n);
+  sz_storage.push_back(1);
+  id = id_storage.data();
+  sz = sz_storage.data();
+  count++;
+  return n++;
+}
+
+template <typename Index>
+bool WeightedQuickUnionUF<Index>::save_snapshot(const std::string &filename) {
+  SnapshotHeader header{};
+  std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+  header.version = 1;
+  header.index_bytes = sizeof(Index);
+  header.num_vertices = static_cast<std::uint64_t>(n);
+  header.count = static_cast<std::uint64_t>(count);
+
+  // Write to a temporary file and rename it into place. A snapshot which is
+  // currently mapped (perhaps by this very object) keeps its old contents.
+  std::string temporary = filename + ".tmp";
+  std::FILE *file = std::fopen(temporary.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+
+  auto length = static_cast<std::size_t>(n);
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(id, sizeof(Index), length, file) == length &&
+            std::fwrite(sz, sizeof(Index), length, file) == length;
+  ok = (std::fclose(file) == 0) && ok;
+  if (!ok || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+template <typename Index>
+bool WeightedQuickUnionUF<Index>::load_snapshot(const std::string &filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat file_stat {};
+  SnapshotHeader header{};
+  bool ok = ::fstat(fd, &file_stat) == 0 &&
+            ::pread(fd, &header, sizeof(header), 0) ==
+                static_cast<ssize_t>(sizeof(header)) &&
+            std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) ==
+                0 &&
+            header.version == 1 && header.index_bytes == sizeof(Index) &&
+            header.num_vertices <= static_cast<std::uint64_t>(
+                                       std::numeric_limits<Index>::max()) &&
+            header.count <= header.num_vertices &&
+            static_cast<std::uint64_t>(file_stat.st_size) ==
+                sizeof(header) + 2 * sizeof(Index) * header.num_vertices;
+
+  void *addr = MAP_FAILED;
+  auto length = static_cast<std::size_t>(file_stat.st_size);
+  if (ok) {
+    // A private, writable mapping: unions after loading copy the pages they
+    // touch instead of writing through to the snapshot file.
+    addr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+
+  unmap();
+  id_storage = vector<Index>();
+  sz_storage = vector<Index>();
+  mapping = addr;
+  mapping_length = length;
+
+  n = static_cast<Index>(header.num_vertices);
+  count = static_cast<Index>(header.count);
+  id = reinterpret_cast<Index *>(static_cast<char *>(addr) + sizeof(header));
+  sz = id + n;
+  return true;
+}
+
+// Assigns dense indices 0, 1, 2, ... to sparse 64-bit vertex IDs in the order
+// they are first seen. Open addressing with linear probing keeps each lookup
+// to a short scan of adjacent slots, and the table doubles whenever it
+// becomes half full.
+class SparseIdMap {
+public:
+  using Index = std::int64_t;
+
+  SparseIdMap() : slots(16) {}
+
+  // Returns the dense index for key, assigning the next one if it's new.
+  Index find_or_insert(std::uint64_t key) {
+    std::size_t mask = slots.size() - 1;
+    for (std::size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+      if (slots[i].index == empty) {
+        slots[i] = Slot{key, num_keys};
+        if (++num_keys * 2 > static_cast<Index>(slots.size()))
+          grow();
+        return num_keys - 1;
+      }
+      if (slots[i].key == key)
+        return slots[i].index;
+    }
+  }
+
+  Index size() { return num_keys; }
+  std::size_t bytes() { return slots.size() * sizeof(Slot); }
+
+private:
+  static constexpr Index empty = -1;
+  struct Slot {
+    std::uint64_t key = 0;
+    Index index = empty;
+  };
+  vector<Slot> slots; // The capacity is always a power of two.
+  Index num_keys = 0;
+
+  // The SplitMix64 finalizer. Hash-like IDs are already well mixed, but
+  // sequential IDs would otherwise cluster in adjacent slots.
+  static std::size_t hash(std::uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::size_t>(x ^ (x >> 31));
+  }
+
+  void grow() {
+    vector<Slot> old_slots(slots.size() * 2);
+    old_slots.swap(slots);
+    std::size_t mask = slots.size() - 1;
+    for (const auto &slot : old_slots) {
+      if (slot.index == empty)
+        continue;
+      std::size_t i = hash(slot.key) & mask;
+      while (slots[i].index != empty)
+        i = (i + 1) & mask;
+      slots[i] = slot;
+    }
+  }
+};
+
+// Afforest (Sutton, Ben-Nun and Barak, 2018) counts connected components in
+// parallel when every edge is known up front. Like the Shiloach-Vishkin
+// algorithm it hooks trees together with compare-and-swap and flattens them
+// by pointer jumping, but it first links only a couple of sampled neighbors
+// per vertex. That is usually enough to gather most vertices into one giant
+// component, whose members can then skip the rest of their edges entirely.
+// Edges are stored in both directions (CSR), so any edge between the giant
+// component and another vertex is still seen from the other end.
+template <typename Index = int> class AfforestCC {
+public:
+  AfforestCC(unsigned _num_threads)
+      : num_threads(std::max(1u, _num_threads)) {}
+
+  Index count_connected_components(Index num_vertices,
+                                   const vector<pair<Index, Index>> &edges);
+
+private:
+  unsigned num_threads;
+  static constexpr std::size_t neighbor_rounds = 2;
+  static constexpr int num_samples = 1024;
+
+  vector<std::size_t> offsets; // CSR: neighbors of v are in
+  vector<Index> neighbors;     // neighbors[offsets[v], offsets[v + 1]).
+  vector<std::atomic<Index>> comp;
+
+  // Split [0, n) into chunks which the threads claim dynamically, since
+  // vertex degrees can be very uneven.
+  template <typename F> void parallel_for(std::size_t n, F body) {
+    const std::size_t chunk = 4096;
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+      for (;;) {
+        std::size_t begin = next.fetch_add(chunk, std::memory_order_relaxed);
+        if (begin >= n)
+          return;
+        std::size_t end = std::min(n, begin + chunk);
+        for (std::size_t i = begin; i < end; i++)
+          body(i);
+      }
+    };
+    vector<std::thread> workers;
+    for (unsigned t = 1; t < num_threads; t++)
+      workers.emplace_back(worker);
+    worker();
+    for (auto &w : workers)
+      w.join();
+  }
+
+  Index load(Index v) { return comp[v].load(std::memory_order_relaxed); }
+
+  // Hook the larger of the two roots under the smaller one.
+  void link(Index u, Index v) {
+    Index p1 = load(u);
+    Index p2 = load(v);
+    while (p1 != p2) {
+      Index high = std::max(p1, p2);
+      Index low = std::min(p1, p2);
+      Index p_high = load(high);
+      if (p_high == low)
+        break;
+      if (p_high == high && comp[high].compare_exchange_strong(
+                                p_high, low, std::memory_order_relaxed))
+        break;
+      p1 = load(load(high));
+      p2 = load(low);
+    }
+  }
+
+  // Pointer jumping, until every vertex points directly at its root.
+  void compress(Index num_vertices) {
+    parallel_for(static_cast<std::size_t>(num_vertices), [&](std::size_t i) {
+      auto v = static_cast<Index>(i);
+      while (load(v) != load(load(v)))
+        comp[v].store(load(load(v)), std::memory_order_relaxed);
+    });
+  }
+
+  void build_csr(Index num_vertices, const vector<pair<Index, Index>> &edges);
+  Index most_frequent_root(Index num_vertices);
+};
+
+template <typename Index>
+void AfforestCC<Index>::build_csr(Index num_vertices,
+                                  const vector<pair<Index, Index>> &edges) {
+  auto n = static_cast<std::size_t>(num_vertices);
+  vector<std::atomic<std::size_t>> cursor(n + 1);
+  parallel_for(n + 1, [&](std::size_t v) {
+    cursor[v].store(0, std::memory_order_relaxed);
+  });
+
+  // Count degrees, then prefix sum them into offsets.
+  parallel_for(edges.size(), [&](std::size_t e) {
+    cursor[static_cast<std::size_t>(edges[e].first)].fetch_add(
+        1, std::memory_order_relaxed);
+    cursor[static_cast<std::size_t>(edges[e].second)].fetch_add(
+        1, std::memory_order_relaxed);
+  });
+  offsets.assign(n + 1, 0);
+  for (std::size_t v = 0; v < n; v++) {
+    offsets[v + 1] = offsets[v] + cursor[v].load(std::memory_order_relaxed);
+    cursor[v].store(offsets[v], std::memory_order_relaxed);
+  }
+
+  // Scatter both directions of each edge.
+  neighbors.resize(offsets[n]);
+  parallel_for(edges.size(), [&](std::size_t e) {
+    auto p = static_cast<std::size_t>(edges[e].first);
+    auto q = static_cast<std::size_t>(edges[e].second);
+    neighbors[cursor[p].fetch_add(1, std::memory_order_relaxed)] =
+        edges[e].second;
+    neighbors[cursor[q].fetch_add(1, std::memory_order_relaxed)] =
+        edges[e].first;
+  });
+}
+
+template <typename Index>
+Index AfforestCC<Index>::most_frequent_root(Index num_vertices) {
+  std::mt19937_64 rng(2018);
+  std::uniform_int_distribution<Index> vertex(0, num_vertices - 1);
+  std::unordered_map<Index, int> frequency;
+  for (int i = 0; i < num_samples; i++)
+    frequency[load(vertex(rng))]++;
+
+  auto most_frequent = frequency.begin();
+  for (auto it = frequency.begin(); it != frequency.end(); ++it) {
+    if (it->second > most_frequent->second)
+      most_frequent = it;
+  }
+  return most_frequent->first;
+}
+
+template <typename Index>
+Index AfforestCC<Index>::count_connected_components(
+    Index num_vertices, const vector<pair<Index, Index>> &edges) {
+  if (num_vertices == 0)
+    return 0;
+  auto n = static_cast<std::size_t>(num_vertices);
+  build_csr(num_vertices, edges);
+
+  // Initialize with reflexive property, each vertex is its own root.
+  comp = vector<std::atomic<Index>>(n);
+  parallel_for(n, [&](std::size_t v) {
+    comp[v].store(static_cast<Index>(v), std::memory_order_relaxed);
+  });
+
+  // Link each vertex to its first few neighbors only.
+  for (std::size_t r = 0; r < neighbor_rounds; r++) {
+    parallel_for(n, [&](std::size_t v) {
+      if (offsets[v] + r < offsets[v + 1])
+        link(static_cast<Index>(v), neighbors[offsets[v] + r]);
+    });
+    compress(num_vertices);
+  }
+
+  // Find the (probable) giant component, then finish linking every vertex
+  // outside of it using the remaining neighbors.
+  Index giant = most_frequent_root(num_vertices);
+  parallel_for(n, [&](std::size_t v) {
+    if (load(static_cast<Index>(v)) == giant)
+      return;
+    for (std::size_t i = offsets[v] + neighbor_rounds; i < offsets[v + 1]; i++)
+      link(static_cast<Index>(v), neighbors[i]);
+  });
+  compress(num_vertices);
+
+  // Each remaining root is one connected component.
+  std::atomic<Index> count{0};
+  parallel_for(n, [&](std::size_t v) {
+    if (load(static_cast<Index>(v)) == static_cast<Index>(v))
+      count.fetch_add(1, std::memory_order_relaxed);
+  });
+  return count.load();
+}
+
+// Sparse mode: each line holds an edge between two arbitrary 64-bit vertex
+// IDs and there is no vertex count. Vertices are added to a 64-bit
+// WeightedQuickUnionUF as they're first seen.
+int run_sparse(std::istream &input) {
+  using std::cout;
+  using std::endl;
+  using Index = SparseIdMap::Index;
+
+  vector<pair<std::uint64_t, std::uint64_t>> raw_edges;
+  std::uint64_t a, b;
+  while (input >> a >> b) {
+    raw_edges.push_back(std::make_pair(a, b));
+  }
+
+  // Map the IDs to dense indices, growing the structure for each new vertex.
+  auto wqu = WeightedQuickUnionUF<Index>(0);
+  SparseIdMap ids;
+  vector<pair<Index, Index>> edges;
+  edges.reserve(raw_edges.size());
+
+  auto map_begin = std::chrono::steady_clock::now();
+  for (auto edge : raw_edges) {
+    Index p = ids.find_or_insert(std::get<0>(edge));
+    Index q = ids.find_or_insert(std::get<1>(edge));
+    while (wqu.size() < ids.size()) {
+      wqu.add_vertex();
+    }
+    edges.push_back(std::make_pair(p, q));
+  }
+  auto map_end = std::chrono::steady_clock::now();
+
+  auto begin = std::chrono::steady_clock::now();
+  auto num_cc = wqu.count_connected_components(edges);
+  auto end = std::chrono::steady_clock::now();
+
+  auto map_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(map_end - map_begin)
+          .count();
+  double num_vertices = std::max(1.0, static_cast<double>(ids.size()));
+  cout << ids.size() << " vertices in the disjoint-set data structure."
+       << endl
+       << edges.size() << " edges in disjoint-set data structurte." << endl
+       << num_cc << " connected components." << endl
+       << "WeightedQuickUnionUF::count_connected_components, elapsed time "
+          "(ns) = "
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+              .count()
+       << endl
+       << "SparseIdMap, mapped " << 2 * raw_edges.size()
+       << " IDs, elapsed time (ns) = " << map_ns << ", throughput (M IDs/s) = "
+       << (map_ns > 0 ? 2e3 * static_cast<double>(raw_edges.size()) /
+                            static_cast<double>(map_ns)
+                      : 0.0)
+       << endl
+       << "Memory per vertex (bytes): id/sz = " << 2 * sizeof(Index)
+       << ", id map = " << static_cast<double>(ids.bytes()) / num_vertices
+       << ", dense mode id/sz = " << 2 * sizeof(int) << endl;
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
   using std::cout;
   using std::endl;
 
-  // Read file given on command line.
+  // Read file given on command line, along with optional snapshot files. When
+  // a snapshot is loaded, the edges file is optional and is applied on top.
   std::string filename;
-  if (argc != 2) {
-    cout << "Usage: union-find ../algs4-data/mediumUF.txt" << endl;
+  std::string load_filename;
+  std::string save_filename;
+  bool sparse = false;
+  bool parallel = false;
+  unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool bad_arguments = false;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--load-snapshot" && i + 1 < argc) {
+      load_filename = argv[++i];
+    } else if (arg == "--save-snapshot" && i + 1 < argc) {
+      save_filename = argv[++i];
+    } else if (arg == "--sparse") {
+      sparse = true;
+    } else if (arg == "--parallel") {
+      parallel = true;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      // Reject anything but 1 to 4096 threads, e.g. -1 or a typo.
+      char *end = nullptr;
+      long requested = std::strtol(argv[++i], &end, 10);
+      bad_arguments |= (*end != '\0' || requested < 1 || requested > 4096);
+      num_threads = static_cast<unsigned>(std::clamp(requested, 1l, 4096l));
+    } else if (filename.empty()) {
+      filename = arg;
+    } else {
+      bad_arguments = true;
+    }
+  }
+  // The sparse ID mapping isn't saved, so it can't be used with snapshots.
+  // The parallel engine needs every edge up front, so it can't continue from
+  // a snapshot either.
+  bool sparse_with_snapshot =
+      (sparse || parallel) && !(load_filename.empty() && save_filename.empty());
+  if (bad_arguments || sparse_with_snapshot || (sparse && parallel) ||
+      (filename.empty() && load_filename.empty())) {
+    cout << "Usage: union-find [--load-snapshot uf.snap] "
+            "[--save-snapshot uf.snap] ../algs4-data/mediumUF.txt"
+         << endl
+         << "       union-find --sparse edges-with-64-bit-ids.txt" << endl
+         << "       union-find --parallel [--threads N] "
+            "../algs4-data/largeUF.txt"
+         << endl;
     return EXIT_FAILURE;
-  } else {
-    filename = argv[1];
   }
 
-  std::ifstream input_file(filename);
-  if (!input_file.is_open()) {
-    cout << "ERROR: failed to open \"" << filename << "\" for reading." << endl;
-    return EXIT_FAILURE;
+  // A filename of "-" reads standard input, e.g. from workload-generator.
+  std::ifstream input_file;
+  if (!filename.empty() && filename != "-") {
+    input_file.open(filename);
+    if (!input_file.is_open()) {
+      cout << "ERROR: failed to open \"" << filename << "\" for reading."
+           << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::istream &input = (filename == "-") ? std::cin : input_file;
+
+  if (sparse) {
+    return run_sparse(input);
   }
 
+  auto startup_begin = std::chrono::steady_clock::now();
+
   // Read a single integer from the first line indicating the number of
   // vertices.
   int num_vertices = 0;
-  input_file >> num_vertices;
+  if (!filename.empty()) {
+    input >> num_vertices;
+  }
 
-  // Instantiate a WeightedQuickUnionUF object.
-  auto wqu = WeightedQuickUnionUF(num_vertices);
+  // Instantiate a WeightedQuickUnionUF object, possibly from a snapshot.
+  auto wqu =
+      WeightedQuickUnionUF<>(load_filename.empty() ? num_vertices : 0);
+  if (!load_filename.empty()) {
+    if (!wqu.load_snapshot(load_filename)) {
+      cout << "ERROR: failed to load snapshot \"" << load_filename << "\"."
+           << endl;
+      return EXIT_FAILURE;
+    }
+    if (num_vertices > wqu.size()) {
+      cout << "ERROR: \"" << filename << "\" has " << num_vertices
+           << " vertices, but the snapshot only has " << wqu.size() << "."
+           << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  auto load_end = std::chrono::steady_clock::now();
 
   // Read the input data into a vector of pairs representing edges in the
   // graph.
   vector<pair<int, int>> edges;
   int p, q;
-  while (input_file >> p >> q) {
+  while (!filename.empty() && input >> p >> q) {
     edges.push_back(std::make_pair(p, q));
   }
-  input_file.close();
 
-  // Apply the weighted quick-union algorithm to the inpur data.
+  // Apply the weighted quick-union algorithm to the input data.
   auto begin = std::chrono::steady_clock::now();
   auto num_cc = wqu.count_connected_components(edges);
   auto end = std::chrono::steady_clock::now();
 
+  // Without a snapshot, startup means reading and replaying every edge.
+  auto startup_end = load_filename.empty() ? end : load_end;
+
+  if (!save_filename.empty() && !wqu.save_snapshot(save_filename)) {
+    cout << "ERROR: failed to save snapshot \"" << save_filename << "\"."
+         << endl;
+    return EXIT_FAILURE;
+  }
+
   // Nice timer code adapted from
   // (https://stackoverflow.com/a/27739925/1615035).
-  cout << num_vertices << " vertices in the disjoint-set data structure."
+  cout << wqu.size() << " vertices in the disjoint-set data structure."
        << endl
        << edges.size() << " edges in disjoint-set data structurte." << endl
        << num_cc << " connected components." << endl
@@ -146,5 +671,41 @@ int main(int argc, char *argv[]) {
           "(ns) = "
        << std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
               .count()
+       << endl
+       << (load_filename.empty() ? "Startup by replaying edges"
+                                 : "Startup from snapshot")
+       << ", elapsed time (ns) = "
+       << std::chrono::duration_cast<std::chrono::nanoseconds>(startup_end -
+                                                                startup_begin)
+              .count()
        << endl;
+
+  if (parallel) {
+    // Run the parallel engine on the same edges and compare.
+    auto afforest = AfforestCC<>(num_threads);
+    auto parallel_begin = std::chrono::steady_clock::now();
+    auto parallel_num_cc =
+        afforest.count_connected_components(wqu.size(), edges);
+    auto parallel_end = std::chrono::steady_clock::now();
+
+    auto sequential_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+            .count();
+    auto parallel_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           parallel_end - parallel_begin)
+                           .count();
+    cout << parallel_num_cc << " connected components (Afforest)." << endl
+         << "AfforestCC::count_connected_components, " << num_threads
+         << " threads, elapsed time (ns) = " << parallel_ns << ", speedup = "
+         << (parallel_ns > 0 ? static_cast<double>(sequential_ns) /
+                                   static_cast<double>(parallel_ns)
+                             : 0.0)
+         << "x" << endl;
+    if (parallel_num_cc != num_cc) {
+      cout << "ERROR: AfforestCC and WeightedQuickUnionUF disagree on the "
+              "number of connected components."
+           << endl;
+      return EXIT_FAILURE;
+    }
+  }
 }
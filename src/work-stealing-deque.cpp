@@ -0,0 +1,514 @@
+//
+//  work-stealing-deque.cpp
+//  Copyright (c) 2017 Dylan Brown. All rights reserved.
+//
+
+// NOTES
+// ResizingArrayStack (see lifo-stack-resizing-array.cpp) is an array-backed
+// LIFO which doubles on demand. The Chase-Lev deque (Chase and Lev, SPAA 2005)
+// is that same stack, made safe for other threads to take items from the
+// opposite end. The owning thread pushes and pops at the bottom, exactly like
+// a stack, while thieves steal the oldest items from the top.
+//
+//          top                 bottom
+//   [ . . . A B C D E F . . . . ]
+//     steal ^           ^ push / pop (owner only)
+//
+// Indices grow without bound and are wrapped into a circular array whose
+// capacity is a power of two. When the owner fills it, a copy twice the size
+// replaces it, as in ResizingArrayStack::resize. A thief may still be reading
+// from the old array, so it is retired rather than freed until the deque is
+// destroyed. The memory orderings follow the C11 version of Le, Pop, Cohen
+// and Zappa Nardelli (PPoPP 2013). Owner and thief only race over the last
+// item, which they settle with a compare-and-swap on top.
+//
+// Scheduler runs fork-join tasks on a pool of threads, each owning one deque.
+// A task spawned by a worker goes on the bottom of its own deque, which keeps
+// recently spawned (cache-hot) work local. Idle workers steal the oldest
+// tasks from a random victim, and those tend to be the largest pieces of
+// work. A worker which finds nothing to steal yields for a while, then parks
+// on a condition variable until spawn() signals that there is new work, so an
+// idle pool costs no CPU time. The benchmarks at the bottom run a recursive
+// Fibonacci and a Shell sort whose h-sorted chains are sorted in parallel,
+// reporting the elapsed time and steal rates for increasing numbers of
+// threads.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+template <typename T> class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Items are copied in and out of atomics, e.g. use pointers.");
+
+public:
+  WorkStealingDeque(std::int64_t capacity = 256) {
+    arrays.push_back(std::make_unique<CircularArray>(capacity));
+    array.store(arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  // Owner only.
+  void push(T item);
+  std::optional<T> pop();
+  // Any thread.
+  std::optional<T> steal();
+
+  bool is_empty() {
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_relaxed);
+    return b <= t;
+  }
+
+private:
+  class CircularArray {
+  public:
+    CircularArray(std::int64_t _capacity)
+        : capacity(_capacity), mask(_capacity - 1),
+          items(std::make_unique<std::atomic<T>[]>(
+              static_cast<std::size_t>(_capacity))) {}
+
+    // Le et al. use relaxed accesses here and rely on the fences. Acquire
+    // and release are free on x86 and also let ThreadSanitizer, which
+    // ignores fences, see that a stolen task was fully written.
+    std::int64_t size() { return capacity; }
+    T get(std::int64_t i) {
+      return items[i & mask].load(std::memory_order_acquire);
+    }
+    void put(std::int64_t i, T item) {
+      items[i & mask].store(item, std::memory_order_release);
+    }
+
+  private:
+    std::int64_t capacity; // Always a power of two.
+    std::int64_t mask;
+    std::unique_ptr<std::atomic<T>[]> items;
+  };
+
+  // Keep top and bottom on separate cache lines, since thieves hammer top.
+  alignas(64) std::atomic<std::int64_t> top{0};
+  alignas(64) std::atomic<std::int64_t> bottom{0};
+  std::atomic<CircularArray *> array{nullptr};
+  // Every array ever allocated, so thieves never read freed memory.
+  std::vector<std::unique_ptr<CircularArray>> arrays;
+
+  CircularArray *grow(CircularArray *old, std::int64_t t, std::int64_t b);
+};
+
+template <typename T>
+typename WorkStealingDeque<T>::CircularArray *
+WorkStealingDeque<T>::grow(CircularArray *old, std::int64_t t,
+                           std::int64_t b) {
+  // Double the capacity and copy each live item across.
+  arrays.push_back(std::make_unique<CircularArray>(2 * old->size()));
+  CircularArray *replacement = arrays.back().get();
+  for (std::int64_t i = t; i < b; i++) {
+    replacement->put(i, old->get(i));
+  }
+  array.store(replacement, std::memory_order_release);
+  return replacement;
+}
+
+template <typename T> void WorkStealingDeque<T>::push(T item) {
+  std::int64_t b = bottom.load(std::memory_order_relaxed);
+  std::int64_t t = top.load(std::memory_order_acquire);
+  CircularArray *a = array.load(std::memory_order_relaxed);
+  if (b - t > a->size() - 1) {
+    a = grow(a, t, b);
+  }
+  a->put(b, item);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+template <typename T> std::optional<T> WorkStealingDeque<T>::pop() {
+  std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  CircularArray *a = array.load(std::memory_order_relaxed);
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // The deque was already empty.
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  T item = a->get(b);
+  if (t == b) {
+    // This was the last item, so race any thieves for it.
+    bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                           std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    if (!won)
+      return std::nullopt;
+  }
+  return item;
+}
+
+template <typename T> std::optional<T> WorkStealingDeque<T>::steal() {
+  std::int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  std::int64_t b = bottom.load(std::memory_order_acquire);
+  if (t >= b)
+    return std::nullopt;
+
+  CircularArray *a = array.load(std::memory_order_acquire);
+  T item = a->get(t);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                   std::memory_order_relaxed)) {
+    return std::nullopt; // Lost the race to the owner or another thief.
+  }
+  return item;
+}
+
+// Counts the tasks spawned into it which haven't finished yet.
+struct TaskGroup {
+  std::atomic<int> pending{0};
+};
+
+class Scheduler {
+public:
+  // The thread which calls run() becomes worker 0, so num_threads - 1 extra
+  // threads are started.
+  explicit Scheduler(unsigned num_threads);
+  ~Scheduler();
+
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  // Run root on the calling thread, with the pool available to its tasks.
+  void run(const std::function<void()> &root);
+
+  // Only valid from inside a task, or the root.
+  void spawn(TaskGroup &group, std::function<void()> fn);
+  void wait(TaskGroup &group);
+
+  struct Stats {
+    std::uint64_t executed = 0;
+    std::uint64_t steal_attempts = 0;
+    std::uint64_t steals = 0;
+  };
+  Stats stats();
+
+private:
+  struct Task {
+    std::function<void()> fn;
+    TaskGroup *group;
+  };
+
+  struct alignas(64) Worker {
+    WorkStealingDeque<Task *> deque;
+    std::atomic<std::uint64_t> executed{0};
+    std::atomic<std::uint64_t> steal_attempts{0};
+    std::atomic<std::uint64_t> steals{0};
+    std::uint64_t rng_state;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> done{false};
+
+  // Idle workers sleep here. spawn() only takes the mutex to wake one when
+  // some worker has announced itself in `sleepers`.
+  std::mutex park_mutex;
+  std::condition_variable park_cv;
+  std::atomic<int> sleepers{0};
+
+  // Index of the worker running on this thread, or -1 outside the pool.
+  static thread_local int worker_index;
+
+  bool run_one(int self);
+  void execute(Worker &worker, Task *task);
+  void park();
+};
+
+thread_local int Scheduler::worker_index = -1;
+
+Scheduler::Scheduler(unsigned num_threads) {
+  num_threads = std::max(1u, num_threads);
+  for (unsigned i = 0; i < num_threads; i++) {
+    workers.push_back(std::make_unique<Worker>());
+    workers.back()->rng_state = 0x9e3779b97f4a7c15ull * (i + 1);
+  }
+  for (unsigned i = 1; i < num_threads; i++) {
+    threads.emplace_back([this, i]() {
+      worker_index = static_cast<int>(i);
+      const int spins_before_parking = 64;
+      int idle = 0;
+      while (!done.load(std::memory_order_acquire)) {
+        if (run_one(worker_index)) {
+          idle = 0;
+        } else if (++idle < spins_before_parking) {
+          std::this_thread::yield();
+        } else {
+          park();
+          idle = 0;
+        }
+      }
+    });
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> lock(park_mutex);
+    done.store(true, std::memory_order_release);
+  }
+  park_cv.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void Scheduler::run(const std::function<void()> &root) {
+  worker_index = 0;
+  root();
+  worker_index = -1;
+}
+
+void Scheduler::spawn(TaskGroup &group, std::function<void()> fn) {
+  group.pending.fetch_add(1, std::memory_order_relaxed);
+  workers[worker_index]->deque.push(new Task{std::move(fn), &group});
+
+  // Pairs with the fence in park(): either a parking worker sees this task,
+  // or we see that it is (about to be) asleep and wake it.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleepers.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(park_mutex);
+    park_cv.notify_one();
+  }
+}
+
+void Scheduler::park() {
+  std::unique_lock<std::mutex> lock(park_mutex);
+  sleepers.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // Check once more for work, now that spawn() is sure to notify us. Holding
+  // the mutex until wait() means the notification can't slip in between.
+  bool work = std::any_of(workers.begin(), workers.end(), [](auto &worker) {
+    return !worker->deque.is_empty();
+  });
+  if (!work && !done.load(std::memory_order_acquire))
+    park_cv.wait(lock); // A spurious wakeup just means another look around.
+  sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Scheduler::wait(TaskGroup &group) {
+  // Rather than block, keep running tasks (ours or stolen) until the
+  // group's tasks have all finished.
+  while (group.pending.load(std::memory_order_acquire) > 0) {
+    if (!run_one(worker_index))
+      std::this_thread::yield();
+  }
+}
+
+void Scheduler::execute(Worker &worker, Task *task) {
+  task->fn();
+  TaskGroup *group = task->group;
+  delete task;
+  worker.executed.fetch_add(1, std::memory_order_relaxed);
+  group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+bool Scheduler::run_one(int self) {
+  Worker &worker = *workers[self];
+  if (auto task = worker.deque.pop()) {
+    execute(worker, *task);
+    return true;
+  }
+  if (workers.size() == 1)
+    return false;
+
+  // Xorshift picks a victim other than ourselves.
+  std::uint64_t &x = worker.rng_state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  auto victim = static_cast<int>(x % (workers.size() - 1));
+  if (victim >= self)
+    victim++;
+
+  worker.steal_attempts.fetch_add(1, std::memory_order_relaxed);
+  if (auto task = workers[victim]->deque.steal()) {
+    worker.steals.fetch_add(1, std::memory_order_relaxed);
+    execute(worker, *task);
+    return true;
+  }
+  return false;
+}
+
+Scheduler::Stats Scheduler::stats() {
+  Stats total;
+  for (auto &worker : workers) {
+    total.executed += worker->executed.load(std::memory_order_relaxed);
+    total.steal_attempts +=
+        worker->steal_attempts.load(std::memory_order_relaxed);
+    total.steals += worker->steals.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+// Fork-join Fibonacci: spawn fib(n - 1), compute fib(n - 2) ourselves, then
+// join. Below the cutoff the recursion runs sequentially.
+std::uint64_t fib(Scheduler &scheduler, int n, int cutoff) {
+  if (n < 2)
+    return static_cast<std::uint64_t>(n);
+  if (n < cutoff)
+    return fib(scheduler, n - 1, cutoff) + fib(scheduler, n - 2, cutoff);
+
+  std::uint64_t x = 0;
+  TaskGroup group;
+  scheduler.spawn(group, [&]() { x = fib(scheduler, n - 1, cutoff); });
+  std::uint64_t y = fib(scheduler, n - 2, cutoff);
+  scheduler.wait(group);
+  return x + y;
+}
+
+// Call body(i) for each i in [begin, end), splitting the range in half until
+// it is no larger than grain.
+template <typename F>
+void parallel_for(Scheduler &scheduler, int begin, int end, int grain,
+                  const F &body) {
+  if (end - begin <= grain) {
+    for (int i = begin; i < end; i++)
+      body(i);
+    return;
+  }
+  int mid = begin + (end - begin) / 2;
+  TaskGroup group;
+  scheduler.spawn(group,
+                  [&]() { parallel_for(scheduler, begin, mid, grain, body); });
+  parallel_for(scheduler, mid, end, grain, body);
+  scheduler.wait(group);
+}
+
+// Shell sort, as in shell-sort.cpp, except that the h interleaved chains of
+// each h-sort are independent and sorted as parallel tasks.
+void parallel_shell_sort(Scheduler &scheduler, std::vector<double> &a) {
+  int N = static_cast<int>(a.size());
+  int h = 1;
+  while (h < N / 3) // Note the integer division.
+    h = 3 * h + 1;  // 1, 4, 13, 40, 121, 364, 1093, ...
+
+  while (h >= 1) {
+    // Aim for at least ~16K elements in each task.
+    int grain = std::max(1, (1 << 14) / std::max(1, N / h));
+    parallel_for(scheduler, 0, h, grain, [&](int chain) {
+      for (int i = chain + h; i < N; i += h) {
+        for (int j = i; j >= h && a[j] < a[j - h]; j -= h)
+          std::swap(a[j], a[j - h]);
+      }
+    });
+    h = h / 3; // Again, note the integer division.
+  }
+}
+
+int main() {
+  using std::cout;
+  using std::endl;
+
+  // Exercise the deque on its own: the owner pushes and pops while thieves
+  // steal, and every item must come out exactly once.
+  {
+    const std::int64_t num_items = 1 << 20;
+    auto deque = WorkStealingDeque<std::int64_t>(4);
+    std::atomic<std::int64_t> total{0};
+    std::atomic<bool> owner_done{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; t++) {
+      thieves.emplace_back([&]() {
+        while (!owner_done.load() || !deque.is_empty()) {
+          if (auto item = deque.steal())
+            total.fetch_add(*item);
+        }
+      });
+    }
+    for (std::int64_t i = 1; i <= num_items; i++) {
+      deque.push(i);
+      if (i % 3 == 0) {
+        if (auto item = deque.pop())
+          total.fetch_add(*item);
+      }
+    }
+    while (auto item = deque.pop()) {
+      total.fetch_add(*item);
+    }
+    owner_done.store(true);
+    for (auto &thief : thieves) {
+      thief.join();
+    }
+    bool ok = total.load() == num_items * (num_items + 1) / 2;
+    cout << "WorkStealingDeque, " << num_items
+         << " items pushed with 3 concurrent thieves, every item taken once: "
+         << (ok ? "true" : "false") << endl;
+    if (!ok)
+      return EXIT_FAILURE;
+  }
+
+  // Scaling runs, with the thread count doubling up to the hardware's.
+  unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+  const int fib_n = 32;
+  const int fib_cutoff = 12;
+  std::vector<double> data(1 << 20);
+  std::mt19937_64 rng(2017);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  for (auto &x : data) {
+    x = uniform(rng);
+  }
+
+  for (unsigned num_threads = 1; num_threads <= max_threads;
+       num_threads *= 2) {
+    Scheduler scheduler(num_threads);
+
+    std::uint64_t result = 0;
+    auto begin = std::chrono::steady_clock::now();
+    scheduler.run([&]() { result = fib(scheduler, fib_n, fib_cutoff); });
+    auto end = std::chrono::steady_clock::now();
+    auto fib_stats = scheduler.stats();
+
+    auto a = data;
+    auto sort_begin = std::chrono::steady_clock::now();
+    scheduler.run([&]() { parallel_shell_sort(scheduler, a); });
+    auto sort_end = std::chrono::steady_clock::now();
+    auto total_stats = scheduler.stats();
+    bool sorted = std::is_sorted(a.begin(), a.end());
+
+    auto report = [&](const char *name, long long ns, std::uint64_t executed,
+                      std::uint64_t attempts, std::uint64_t steals) {
+      cout << name << ", " << num_threads
+           << " threads, elapsed time (ns) = " << ns << ", tasks = " << executed
+           << ", steals = " << steals << " of " << attempts << " attempts ("
+           << (attempts > 0 ? 100.0 * static_cast<double>(steals) /
+                                  static_cast<double>(attempts)
+                            : 0.0)
+           << "%)" << endl;
+    };
+    report(("fib(" + std::to_string(fib_n) + ") = " + std::to_string(result))
+               .c_str(),
+           std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+               .count(),
+           fib_stats.executed, fib_stats.steal_attempts, fib_stats.steals);
+    report(sorted ? "parallel_shell_sort" : "ERROR: parallel_shell_sort",
+           std::chrono::duration_cast<std::chrono::nanoseconds>(sort_end -
+                                                                sort_begin)
+               .count(),
+           total_stats.executed - fib_stats.executed,
+           total_stats.steal_attempts - fib_stats.steal_attempts,
+           total_stats.steals - fib_stats.steals);
+    if (!sorted)
+      return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,322 @@
+//
+//  workload-generator.cpp
+//  Copyright (c) 2017 Dylan Brown. All rights reserved.
+//
+
+// NOTES
+// The benchmarks for the sorts and union-find were run against sample data
+// from the book's website (medTale.txt, words3.txt, mediumUF.txt). That data
+// isn't in this repository, so this generator produces seeded workloads of any
+// size instead. A given seed always produces the same bytes on any platform,
+// because the random numbers come from SplitMix64 rather than the
+// implementation-defined std:: distributions.
+//
+// Sort workloads are whitespace separated words, with lengths following a
+// Zipf distribution (short words are common and long words are rare).
+//   random      independent random words.
+//   sorted      ascending order.
+//   reversed    descending order.
+//   sawtooth    16 ascending runs, one after the other.
+//   few-unique  words drawn from a vocabulary of 16.
+//
+// Union-find workloads use the format read by union-find: the number of
+// vertices on the first line, followed by one "p q" edge per line.
+//   random      n edges between uniformly chosen vertices.
+//   grid        a sqrt(n) x sqrt(n) lattice, with edges right and down.
+//   power-law   n edges, each with one endpoint drawn from a power law so
+//               that a few hub vertices collect most of the edges.
+//   path        the path graph 0-1-2-...-(n-1).
+//   dynamic     n operations for union-find-rollback: edges added ("+ p q")
+//               and removed ("- p q"), mixed with queries ("? p q" and "#").
+//
+// Output is written to stdout, so it can be piped straight into a sort
+// executable or union-find (pass "-" as their filename), or to a file.
+//   ./workload-generator sort random 1000000 | ./shell-sort --checksum -
+
+#include "bulk-writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::uint64_t;
+
+// SplitMix64 (Steele, Lea and Flood, 2014). Small, fast, and fully specified.
+class SplitMix64 {
+public:
+  explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform on [0, 1) with 53 bits of precision.
+  double uniform() {
+    return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  // Uniform on [0, bound). The modulo bias is negligible for our purposes.
+  uint64_t below(uint64_t bound) { return next() % bound; }
+
+private:
+  uint64_t state;
+};
+
+class WordGenerator {
+public:
+  WordGenerator(SplitMix64 &_rng) : rng(_rng) {
+    // Zipf weights 1/k for word lengths k = 1, ..., max_length.
+    double total = 0.0;
+    for (int k = 1; k <= max_length; k++) {
+      total += 1.0 / k;
+      cumulative.push_back(total);
+    }
+    for (auto &c : cumulative) {
+      c /= total;
+    }
+  }
+
+  int zipf_length() {
+    double u = rng.uniform();
+    int k = 0;
+    while (k < max_length - 1 && u >= cumulative[k])
+      k++;
+    return k + 1;
+  }
+
+  // A word with a Zipf distributed length and random letters.
+  void random_word(string &word) {
+    word.clear();
+    append_letters(word, zipf_length());
+  }
+
+  // A word which sorts in the same position as `rank` among [0, n). The rank
+  // is written in base 26 with a fixed width, then padded with random letters
+  // up to a Zipf distributed length.
+  void ranked_word(string &word, uint64_t rank, uint64_t n) {
+    int width = 1;
+    for (uint64_t m = n - 1; m >= 26; m /= 26)
+      width++;
+
+    word.assign(width, 'a');
+    for (int i = width - 1; i >= 0; i--) {
+      word[i] = static_cast<char>('a' + rank % 26);
+      rank /= 26;
+    }
+    int length = zipf_length();
+    if (length > width)
+      append_letters(word, length - width);
+  }
+
+private:
+  static constexpr int max_length = 16;
+  SplitMix64 &rng;
+  std::vector<double> cumulative;
+
+  void append_letters(string &word, int count) {
+    for (int i = 0; i < count; i++) {
+      word.push_back(static_cast<char>('a' + rng.below(26)));
+    }
+  }
+};
+
+void generate_sort(const string &distribution, uint64_t n, SplitMix64 &rng,
+                   BulkWriter &out) {
+  WordGenerator words(rng);
+  string word;
+
+  std::vector<string> vocabulary(16);
+  for (auto &v : vocabulary) {
+    words.random_word(v);
+  }
+  uint64_t period = (n + 15) / 16; // Length of each sawtooth run.
+
+  for (uint64_t i = 0; i < n; i++) {
+    if (distribution == "random") {
+      words.random_word(word);
+    } else if (distribution == "sorted") {
+      words.ranked_word(word, i, n);
+    } else if (distribution == "reversed") {
+      words.ranked_word(word, n - 1 - i, n);
+    } else if (distribution == "sawtooth") {
+      words.ranked_word(word, i % period, period);
+    } else { // few-unique
+      word = vocabulary[rng.below(vocabulary.size())];
+    }
+    out.write(word);
+    out.write('\n');
+  }
+}
+
+void write_edge(BulkWriter &out, uint64_t p, uint64_t q) {
+  out.write(p);
+  out.write(' ');
+  out.write(q);
+  out.write('\n');
+}
+
+void generate_uf(const string &distribution, uint64_t n, SplitMix64 &rng,
+                 BulkWriter &out) {
+  if (distribution == "grid") {
+    auto side = static_cast<uint64_t>(std::sqrt(static_cast<double>(n)));
+    while ((side + 1) * (side + 1) <= n)
+      side++;
+    out.write(side * side);
+    out.write('\n');
+    for (uint64_t row = 0; row < side; row++) {
+      for (uint64_t col = 0; col < side; col++) {
+        uint64_t v = row * side + col;
+        if (col + 1 < side)
+          write_edge(out, v, v + 1);
+        if (row + 1 < side)
+          write_edge(out, v, v + side);
+      }
+    }
+    return;
+  }
+
+  out.write(n);
+  out.write('\n');
+  if (distribution == "path") {
+    for (uint64_t v = 0; v + 1 < n; v++) {
+      write_edge(out, v, v + 1);
+    }
+    return;
+  }
+
+  if (distribution == "dynamic") {
+    // Half of the operations add an edge, a quarter remove a live edge and
+    // the rest are queries.
+    std::vector<std::pair<uint64_t, uint64_t>> live;
+    for (uint64_t i = 0; i < n; i++) {
+      uint64_t choice = rng.below(4);
+      if (choice < 2 || live.empty()) {
+        live.push_back({rng.below(n), rng.below(n)});
+        out.write("+ ");
+        write_edge(out, live.back().first, live.back().second);
+      } else if (choice == 2) {
+        auto k = rng.below(live.size());
+        out.write("- ");
+        write_edge(out, live[k].first, live[k].second);
+        live[k] = live.back();
+        live.pop_back();
+      } else if (rng.below(2) == 0) {
+        out.write("? ");
+        write_edge(out, rng.below(n), rng.below(n));
+      } else {
+        out.write("#\n");
+      }
+    }
+    return;
+  }
+
+  // Inverse CDF of a Pareto distribution (density ~ 1/x^2) truncated to
+  // [1, n + 1), so vertex 0 collects about half of the hub endpoints.
+  const double scale = 1.0 - 1.0 / (static_cast<double>(n) + 1.0);
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t p;
+    if (distribution == "power-law") {
+      double x = 1.0 / (1.0 - rng.uniform() * scale);
+      p = std::min(static_cast<uint64_t>(x) - 1, n - 1);
+    } else { // random
+      p = rng.below(n);
+    }
+    write_edge(out, p, rng.below(n));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  using std::cout;
+  using std::endl;
+
+  // Positional arguments are the workload, distribution and size. Options may
+  // appear anywhere.
+  std::vector<string> positional;
+  string output_filename;
+  uint64_t seed = 2017;
+  bool bad_arguments = false;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--seed" && i + 1 < argc) {
+      char *end = nullptr;
+      seed = std::strtoull(argv[++i], &end, 10);
+      bad_arguments |= (*end != '\0');
+    } else if (arg == "--output" && i + 1 < argc) {
+      output_filename = argv[++i];
+    } else {
+      positional.push_back(arg);
+    }
+  }
+
+  uint64_t n = 0;
+  if (positional.size() == 3) {
+    char *end = nullptr;
+    n = std::strtoull(positional[2].c_str(), &end, 10);
+    bad_arguments |= (*end != '\0' || n == 0);
+  } else {
+    bad_arguments = true;
+  }
+
+  const std::vector<string> sort_distributions = {
+      "random", "sorted", "reversed", "sawtooth", "few-unique"};
+  const std::vector<string> uf_distributions = {"random", "grid", "power-law",
+                                                "path", "dynamic"};
+  auto contains = [](const std::vector<string> &names, const string &name) {
+    for (const auto &candidate : names) {
+      if (candidate == name)
+        return true;
+    }
+    return false;
+  };
+  if (!bad_arguments) {
+    const auto &workload = positional[0];
+    const auto &distribution = positional[1];
+    bad_arguments =
+        !((workload == "sort" && contains(sort_distributions, distribution)) ||
+          (workload == "uf" && contains(uf_distributions, distribution)));
+  }
+
+  if (bad_arguments) {
+    cout << "Usage: workload-generator sort "
+            "{random|sorted|reversed|sawtooth|few-unique} N [--seed S] "
+            "[--output FILE]"
+         << endl
+         << "       workload-generator uf "
+            "{random|grid|power-law|path|dynamic} N [--seed S] "
+            "[--output FILE]"
+         << endl;
+    return EXIT_FAILURE;
+  }
+
+  std::FILE *output_stream = stdout;
+  if (!output_filename.empty()) {
+    output_stream = std::fopen(output_filename.c_str(), "wb");
+    if (output_stream == nullptr) {
+      cout << "ERROR: failed to open \"" << output_filename
+           << "\" for writing." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  SplitMix64 rng(seed);
+  BulkWriter out(output_stream);
+  if (positional[0] == "sort") {
+    generate_sort(positional[1], n, rng, out);
+  } else {
+    generate_uf(positional[1], n, rng, out);
+  }
+  if (!out.close()) {
+    cout << "ERROR: failed to write the workload." << endl;
+    return EXIT_FAILURE;
+  }
+}